@@ -0,0 +1,155 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "Node.h"
+
+/*
+Binary search tree whose nodes live in one vector, children are 32 bit
+indices instead of shared_ptrs. For int keys a node is 12 bytes and there is
+no allocation per node, against a BNode with two shared_ptrs and a parent
+pointer in its own make_shared block for BinarySearchTree (the benchmark
+prints both sizes). Neighbouring nodes share cache lines, so the top of the
+tree and nodes created together stay close in memory.
+
+Growing the vector moves the nodes but not their indices, so the links stay
+valid. Up to 2^32 - 1 nodes. Not rebalanced (like BalanceMode::kNone):
+random keys give O(log n) depth, from_sorted builds a perfectly balanced tree.
+*/
+template <class Key, class Compare = std::less<Key>>
+class ArenaBinarySearchTree {
+ public:
+  using Node = ArenaTreeNode<Key>;
+  using key_type = Key;
+
+  ArenaBinarySearchTree() = default;
+  ArenaBinarySearchTree(std::initializer_list<Key> list) {
+    reserve(list.size());
+    for (auto it = list.begin(); it != list.end(); it++) {
+      insert(*it);
+    }
+  }
+
+  // Balanced tree from sorted, unique keys in O(n). The nodes are stored in
+  // preorder, a node is followed by its left subtree.
+  template <class RandomIt>
+  static ArenaBinarySearchTree from_sorted(RandomIt first, RandomIt last) {
+    ArenaBinarySearchTree tree;
+    size_t count = static_cast<size_t>(last - first);
+    checkCapacity(count);
+    tree.m_nodes.reserve(count);
+    if (count > 0) tree.linkBalanced(first, count);
+    return tree;
+  }
+
+  // false if the key is already there. Throws std::length_error when the
+  // indices are used up.
+  bool insert(const Key& key) {
+    if (m_nodes.empty()) {
+      m_nodes.push_back(Node{key});
+      return true;
+    }
+    uint32_t index = 0;
+    while (true) {
+      const Node& node = m_nodes[index];
+      bool go_left;
+      if (m_compare(key, node.value)) {
+        go_left = true;
+      } else if (m_compare(node.value, key)) {
+        go_left = false;
+      } else {
+        return false;
+      }
+      uint32_t child = go_left ? node.left : node.right;
+      if (child == 0) {
+        checkCapacity(m_nodes.size() + 1);
+        uint32_t new_index = static_cast<uint32_t>(m_nodes.size());
+        // Link only after push_back succeeded, a throwing push_back leaves
+        // the tree unchanged. It may reallocate, so the parent is fetched
+        // again.
+        m_nodes.push_back(Node{key});
+        Node& parent = m_nodes[index];
+        (go_left ? parent.left : parent.right) = new_index;
+        return true;
+      }
+      index = child;
+    }
+  }
+
+  // The stored key or nullptr, valid until the next insert.
+  const Key* lookup(const Key& key) const {
+    if (m_nodes.empty()) return nullptr;
+    const Node* nodes = m_nodes.data();
+    uint32_t index = 0;
+    while (true) {
+      const Node& node = nodes[index];
+      if (m_compare(key, node.value)) {
+        index = node.left;
+      } else if (m_compare(node.value, key)) {
+        index = node.right;
+      } else {
+        return &node.value;
+      }
+      if (index == 0) return nullptr;
+    }
+  }
+  bool contains(const Key& key) const { return lookup(key) != nullptr; }
+
+  void reserve(size_t count) {
+    checkCapacity(count);
+    m_nodes.reserve(count);
+  }
+  size_t size() const { return m_nodes.size(); }
+  bool empty() const { return m_nodes.empty(); }
+  // Bytes held by the arena, capacity included.
+  size_t memory_usage() const { return m_nodes.capacity() * sizeof(Node); }
+
+  // Number of levels, 0 for an empty tree. O(n).
+  int height() const {
+    int levels = 0;
+    std::vector<uint32_t> level;
+    if (!m_nodes.empty()) level.push_back(0);
+    while (!level.empty()) {
+      levels++;
+      std::vector<uint32_t> next_level;
+      for (uint32_t index : level) {
+        if (m_nodes[index].left) next_level.push_back(m_nodes[index].left);
+        if (m_nodes[index].right) next_level.push_back(m_nodes[index].right);
+      }
+      level.swap(next_level);
+    }
+    return levels;
+  }
+
+ private:
+  static void checkCapacity(size_t count) {
+    if (count > std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error("ArenaBinarySearchTree: too many nodes");
+    }
+  }
+
+  // Appends the middle key, then links both halves below it; returns its
+  // index. count > 0. The recursion is log2(count) deep.
+  template <class RandomIt>
+  uint32_t linkBalanced(RandomIt first, size_t count) {
+    size_t middle = count / 2;
+    uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node{first[middle]});
+    if (middle > 0) {
+      uint32_t left = linkBalanced(first, middle);
+      m_nodes[index].left = left;
+    }
+    if (count - middle - 1 > 0) {
+      uint32_t right = linkBalanced(first + middle + 1, count - middle - 1);
+      m_nodes[index].right = right;
+    }
+    return index;
+  }
+
+  std::vector<Node> m_nodes;  // m_nodes[0] is the root
+  Compare m_compare;
+};
@@ -0,0 +1,308 @@
+﻿#pragma once
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BPLUS_TREE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/*
+B+ tree of unique ints with the BinarySearchTree insert/lookup API.
+Inner nodes hold up to 32 separator keys, leaves up to 64 keys, both start on
+a 64 byte boundary, so one level costs a few neighbouring cache lines instead
+of one miss per binary level. All keys live in the leaves, and the leaves are
+linked left to right for in order scans.
+
+                  [ 40 | 80 ]
+                /      |      \
+   [10 20 30] -> [40 50 60 70] -> [80 90]
+
+Unused key slots hold INT_MAX, so a node is searched over its full width
+with SSE2 compares and no tail loop.
+*/
+class BPlusTree {
+ private:
+  enum : int { kInnerKeys = 32, kLeafKeys = 64, kMaxDepth = 16 };
+  enum : size_t { kLineBytes = 64 };
+
+  struct Leaf {
+    Leaf() { std::fill(keys, keys + kLeafKeys, INT_MAX); }
+    int keys[kLeafKeys];
+    int count{0};
+    Leaf* next{nullptr};
+  };
+  struct Inner;
+  union Child {
+    Inner* inner;
+    Leaf* leaf;
+  };
+  // children[i] holds the keys in [keys[i - 1], keys[i])
+  struct Inner {
+    Inner() { std::fill(keys, keys + kInnerKeys, INT_MAX); }
+    int keys[kInnerKeys];
+    Child children[kInnerKeys + 1];
+    int count{0};
+  };
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const int*;
+    using reference = const int&;
+
+    const_iterator() = default;
+    const_iterator(const Leaf* leaf, int pos) : m_leaf(leaf), m_pos(pos) {}
+
+    reference operator*() const { return m_leaf->keys[m_pos]; }
+    pointer operator->() const { return &m_leaf->keys[m_pos]; }
+    const_iterator& operator++() {
+      if (++m_pos == m_leaf->count) {
+        m_leaf = m_leaf->next;
+        m_pos = 0;
+      }
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return m_leaf == rhs.m_leaf && m_pos == rhs.m_pos;
+    }
+    bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+   private:
+    const Leaf* m_leaf{nullptr};
+    int m_pos{0};
+  };
+  using iterator = const_iterator;
+  using value_type = int;
+
+  BPlusTree() = default;
+  BPlusTree(std::initializer_list<int> list) {
+    for (auto it = list.begin(); it != list.end(); it++) {
+      insert(*it);
+    }
+  }
+  BPlusTree(const BPlusTree&) = delete;
+  BPlusTree& operator=(const BPlusTree&) = delete;
+  BPlusTree(BPlusTree&& rhs) { swap(rhs); }
+  BPlusTree& operator=(BPlusTree&& rhs) {
+    BPlusTree temp(std::move(rhs));
+    swap(temp);
+    return *this;
+  }
+  ~BPlusTree() {
+    if (m_first) destroy(m_root, m_depth);
+  }
+
+  void swap(BPlusTree& rhs) {
+    std::swap(m_root, rhs.m_root);
+    std::swap(m_depth, rhs.m_depth);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_first, rhs.m_first);
+  }
+
+  /*
+  Insert into the leaf, a full leaf is split in two halves and the first key
+  of the right half goes up. Full inner nodes split the same way, a root split
+  adds a level on top.
+  */
+  bool insert(int key) {
+    if (!m_first) {
+      m_root.leaf = m_first = allocateNode<Leaf>();
+    }
+
+    Inner* path[kMaxDepth];
+    int slots[kMaxDepth];
+    Child node = m_root;
+    for (int depth = 0; depth < m_depth; depth++) {
+      int slot = childIndex(node.inner, key);
+      path[depth] = node.inner;
+      slots[depth] = slot;
+      node = node.inner->children[slot];
+    }
+
+    Leaf* leaf = node.leaf;
+    int pos = countLess<kLeafKeys>(leaf->keys, key);
+    if (pos < leaf->count && leaf->keys[pos] == key) return false;
+    m_size++;
+
+    if (leaf->count < kLeafKeys) {
+      insertAt(leaf->keys, leaf->count, pos, key);
+      leaf->count++;
+      return true;
+    }
+    Leaf* right = splitLeaf(leaf, pos, key);
+    int separator = right->keys[0];
+    Child new_child;
+    new_child.leaf = right;
+
+    for (int depth = m_depth - 1; depth >= 0; depth--) {
+      Inner* inner = path[depth];
+      int slot = slots[depth];
+      if (inner->count < kInnerKeys) {
+        insertAt(inner->keys, inner->count, slot, separator);
+        insertAt(inner->children, inner->count + 1, slot + 1, new_child);
+        inner->count++;
+        return true;
+      }
+      new_child.inner = splitInner(inner, slot, separator, new_child);
+    }
+
+    Inner* root = allocateNode<Inner>();
+    root->keys[0] = separator;
+    root->children[0] = m_root;
+    root->children[1] = new_child;
+    root->count = 1;
+    m_root.inner = root;
+    m_depth++;
+    return true;
+  }
+
+  // Pointer to the stored key, nullptr if it is not there.
+  const int* lookup(int key) const {
+    const_iterator it = lower_bound(key);
+    return it != end() && *it == key ? &*it : nullptr;
+  }
+  bool contains(int key) const { return lookup(key) != nullptr; }
+
+  // First key not less than key.
+  const_iterator lower_bound(int key) const {
+    if (!m_first) return end();
+    Child node = m_root;
+    for (int depth = 0; depth < m_depth; depth++) {
+      node = node.inner->children[childIndex(node.inner, key)];
+    }
+    const Leaf* leaf = node.leaf;
+    int pos = countLess<kLeafKeys>(leaf->keys, key);
+    if (pos == leaf->count) return const_iterator(leaf->next, 0);
+    return const_iterator(leaf, pos);
+  }
+
+  const_iterator begin() const { return const_iterator(m_first, 0); }
+  const_iterator end() const { return const_iterator(); }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  // Levels of inner nodes above the leaves.
+  int depth() const { return m_depth; }
+
+ private:
+  // Number of keys[0..N) less than x, unused slots (INT_MAX) never are.
+  template <int N>
+  static int countLess(const int* keys, int x) {
+#ifdef BPLUS_TREE_SSE2
+    __m128i value = _mm_set1_epi32(x);
+    __m128i count = _mm_setzero_si128();
+    for (int i = 0; i < N; i += 4) {
+      __m128i block =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(keys + i));
+      count = _mm_sub_epi32(count, _mm_cmplt_epi32(block, value));
+    }
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0x4E));
+    count = _mm_add_epi32(count, _mm_shuffle_epi32(count, 0xB1));
+    return _mm_cvtsi128_si32(count);
+#else
+    int count = 0;
+    for (int i = 0; i < N; i++) count += keys[i] < x;
+    return count;
+#endif
+  }
+
+  // The child to descend into: number of separators <= x.
+  static int childIndex(const Inner* inner, int x) {
+    int less = countLess<kInnerKeys>(inner->keys, x);
+    return less + (less < inner->count && inner->keys[less] == x);
+  }
+
+  template <class U>
+  static void insertAt(U* items, int count, int pos, const U& item) {
+    std::copy_backward(items + pos, items + count, items + count + 1);
+    items[pos] = item;
+  }
+
+  // Split a full leaf with key going to pos, returns the new right leaf.
+  Leaf* splitLeaf(Leaf* leaf, int pos, int key) {
+    int all[kLeafKeys + 1];
+    std::copy(leaf->keys, leaf->keys + pos, all);
+    all[pos] = key;
+    std::copy(leaf->keys + pos, leaf->keys + kLeafKeys, all + pos + 1);
+
+    Leaf* right = allocateNode<Leaf>();
+    int left_count = (kLeafKeys + 1) / 2;
+    std::fill(leaf->keys, leaf->keys + kLeafKeys, INT_MAX);
+    std::copy(all, all + left_count, leaf->keys);
+    std::copy(all + left_count, all + kLeafKeys + 1, right->keys);
+    leaf->count = left_count;
+    right->count = kLeafKeys + 1 - left_count;
+    right->next = leaf->next;
+    leaf->next = right;
+    return right;
+  }
+
+  // Split a full inner node while adding separator/child at slot. The middle
+  // key moves up and is returned in separator.
+  Inner* splitInner(Inner* inner, int slot, int& separator, Child child) {
+    int keys[kInnerKeys + 1];
+    Child children[kInnerKeys + 2];
+    std::copy(inner->keys, inner->keys + kInnerKeys, keys);
+    std::copy(inner->children, inner->children + kInnerKeys + 1, children);
+    insertAt(keys, kInnerKeys, slot, separator);
+    insertAt(children, kInnerKeys + 1, slot + 1, child);
+
+    Inner* right = allocateNode<Inner>();
+    int mid = (kInnerKeys + 1) / 2;
+    std::fill(inner->keys, inner->keys + kInnerKeys, INT_MAX);
+    std::copy(keys, keys + mid, inner->keys);
+    std::copy(children, children + mid + 1, inner->children);
+    inner->count = mid;
+    std::copy(keys + mid + 1, keys + kInnerKeys + 1, right->keys);
+    std::copy(children + mid + 1, children + kInnerKeys + 2, right->children);
+    right->count = kInnerKeys - mid;
+    separator = keys[mid];
+    return right;
+  }
+
+  // Nodes start on a cache line, the block from operator new is kept right
+  // in front of the node.
+  template <class Node>
+  static Node* allocateNode() {
+    char* raw = static_cast<char*>(
+        ::operator new(sizeof(Node) + kLineBytes + sizeof(void*)));
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    uintptr_t line = (start + kLineBytes - 1) / kLineBytes * kLineBytes;
+    char* aligned = raw + (line - reinterpret_cast<uintptr_t>(raw));
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return new (aligned) Node();
+  }
+  template <class Node>
+  static void freeNode(Node* node) {
+    ::operator delete(reinterpret_cast<void**>(node)[-1]);
+  }
+
+  // Depth is O(log n), plain recursion is fine.
+  static void destroy(Child node, int depth) {
+    if (depth == 0) return freeNode(node.leaf);
+    for (int i = 0; i <= node.inner->count; i++) {
+      destroy(node.inner->children[i], depth - 1);
+    }
+    freeNode(node.inner);
+  }
+
+  Child m_root{nullptr};
+  int m_depth{0};
+  size_t m_size{0};
+  Leaf* m_first{nullptr};
+};
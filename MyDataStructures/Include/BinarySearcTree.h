@@ -1,67 +1,851 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "EytzingerTree.h"
 #include "Node.h"
 
-class BinarySearchTree {
+/*
+kNone keeps the insertion order shape: sorted input gives a list, O(n) lookup.
+kAvl rebalances on insert and erase, the height stays under 1.44 log2(n).
+*/
+enum class BalanceMode { kNone, kAvl };
+
+/*
+In order iterator over TreeNode<Key, Mapped>. ++ and -- follow the child and
+parent links, no stack is kept and nothing is allocated. end() is nullptr,
+--end() finds the largest key from the tree's root.
+Keys are read only, the mapped value is reached through node().
+*/
+template <class Key, class Mapped>
+class TreeIterator {
+ public:
+  using Node = TreeNode<Key, Mapped>;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = Key;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Key*;
+  using reference = const Key&;
+
+  TreeIterator() = default;
+  TreeIterator(Node* node, const std::shared_ptr<Node>* root)
+      : m_node(node), m_root(root) {}
+
+  reference operator*() const { return m_node->value; }
+  pointer operator->() const { return &m_node->value; }
+
+  TreeIterator& operator++() {
+    if (m_node->right) {
+      m_node = m_node->right.get();
+      while (m_node->left) m_node = m_node->left.get();
+    } else {
+      const Node* child;
+      do {
+        child = m_node;
+        m_node = m_node->parent;
+      } while (m_node && m_node->right.get() == child);
+    }
+    return *this;
+  }
+  TreeIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+  TreeIterator& operator--() {
+    if (!m_node) {
+      m_node = m_root->get();
+      while (m_node->right) m_node = m_node->right.get();
+    } else if (m_node->left) {
+      m_node = m_node->left.get();
+      while (m_node->right) m_node = m_node->right.get();
+    } else {
+      const Node* child;
+      do {
+        child = m_node;
+        m_node = m_node->parent;
+      } while (m_node && m_node->left.get() == child);
+    }
+    return *this;
+  }
+  TreeIterator operator--(int) {
+    auto temp = *this;
+    --*this;
+    return temp;
+  }
+
+  bool operator==(const TreeIterator& rhs) const {
+    return m_node == rhs.m_node;
+  }
+  bool operator!=(const TreeIterator& rhs) const {
+    return m_node != rhs.m_node;
+  }
+
+  Node* node() const { return m_node; }
+
+ private:
+  Node* m_node{nullptr};
+  const std::shared_ptr<Node>* m_root{nullptr};
+};
+
+/*
+Binary search tree keyed by Key, ordered by Compare, every node carries a
+Mapped payload. Without a Mapped it is a set, BinarySearchTree is the int
+set like LinkedList is the int list.
+A Compare with is_transparent (e.g. std::less<>) also finds keys by any type
+it can compare with Key: a std::string_view for std::string keys.
+*/
+template <class Key, class Mapped = NoMapped, class Compare = std::less<Key>>
+class BasicBinarySearchTree {
  public:
-  BinarySearchTree() = default;
-  BinarySearchTree(int value) { insert(value); }
-  BinarySearchTree(std::initializer_list<int> list) {
+  using key_type = Key;
+  using mapped_type = Mapped;
+  using key_compare = Compare;
+  using Node = TreeNode<Key, Mapped>;
+  using NodeSharedPtr = std::shared_ptr<Node>;
+  using value_type = Key;
+  using const_iterator = TreeIterator<Key, Mapped>;
+  using iterator = const_iterator;
+
+  BasicBinarySearchTree() = default;
+  explicit BasicBinarySearchTree(BalanceMode mode) : m_mode(mode) {}
+  explicit BasicBinarySearchTree(const Compare& compare,
+                                 BalanceMode mode = BalanceMode::kNone)
+      : m_compare(compare), m_mode(mode) {}
+  BasicBinarySearchTree(const Key& value) { insert(value); }
+  BasicBinarySearchTree(std::initializer_list<Key> list,
+                        BalanceMode mode = BalanceMode::kNone)
+      : m_mode(mode) {
     for (auto it = list.begin(); it != list.end(); it++) {
       insert(*it);
     }
   }
-  bool insert(int value) {
-    auto new_node = createNode(value);
-    if (!m_root) {
-      m_root = new_node;
-      return true;
+  // Deep copy, O(n): inserts and erases rotate and relink nodes in place, a
+  // copy must not share them.
+  BasicBinarySearchTree(const BasicBinarySearchTree& other)
+      : m_root(copyTree(other.m_root.get())),
+        m_size(other.m_size),
+        m_compare(other.m_compare),
+        m_mode(other.m_mode) {}
+  BasicBinarySearchTree(BasicBinarySearchTree&& other) noexcept
+      : m_root(std::move(other.m_root)),
+        m_size(other.m_size),
+        m_compare(std::move(other.m_compare)),
+        m_mode(other.m_mode) {
+    other.m_size = 0;
+  }
+  BasicBinarySearchTree& operator=(BasicBinarySearchTree other) {
+    swap(other);
+    return *this;
+  }
+  void swap(BasicBinarySearchTree& other) noexcept {
+    using std::swap;
+    swap(m_root, other.m_root);
+    swap(m_size, other.m_size);
+    swap(m_compare, other.m_compare);
+    swap(m_mode, other.m_mode);
+  }
+  ~BasicBinarySearchTree() {
+    // Release the nodes with an explicit stack, a degenerated tree would
+    // recurse once per level in ~Node. Nodes still shared are left alone.
+    std::vector<NodeSharedPtr> stack;
+    if (m_root) stack.push_back(std::move(m_root));
+    while (!stack.empty()) {
+      auto node = std::move(stack.back());
+      stack.pop_back();
+      if (node.use_count() != 1) continue;
+      if (node->left) stack.push_back(std::move(node->left));
+      if (node->right) stack.push_back(std::move(node->right));
     }
+  }
 
-    auto current_node = m_root;
+  // false if the key is already there, its mapped value is left alone.
+  bool insert(const Key& value) { return emplaceKey(value).second; }
 
-    BNodeSharedPtr prev;
-    while (1) {
-      auto previous_node = current_node;
-      if (value < current_node->value) {
-        if (current_node->left) {
-          current_node = current_node->left;
-        } else {
-          current_node->left = new_node;
-          return true;
-        }
-      } else if (value > current_node->value) {
-        if (current_node->right) {
-          current_node = current_node->right;
-        } else {
-          current_node->right = new_node;
-          return true;
-        }
+  // Construct the mapped value from args only if key is not there yet.
+  template <class... Args>
+  std::pair<NodeSharedPtr, bool> try_emplace(const Key& key, Args&&... args) {
+    return emplaceKey(key, std::forward<Args>(args)...);
+  }
+  template <class... Args>
+  std::pair<NodeSharedPtr, bool> try_emplace(Key&& key, Args&&... args) {
+    return emplaceKey(std::move(key), std::forward<Args>(args)...);
+  }
+
+  // Insert, or overwrite the mapped value of an existing key.
+  template <class M>
+  std::pair<NodeSharedPtr, bool> insert_or_assign(const Key& key, M&& obj) {
+    auto result = emplaceKey(key, std::forward<M>(obj));
+    if (!result.second) result.first->mapped = std::forward<M>(obj);
+    return result;
+  }
+  template <class M>
+  std::pair<NodeSharedPtr, bool> insert_or_assign(Key&& key, M&& obj) {
+    auto result = emplaceKey(std::move(key), std::forward<M>(obj));
+    if (!result.second) result.first->mapped = std::forward<M>(obj);
+    return result;
+  }
+
+  /*
+  Perfectly balanced tree from a range sorted by Compare without duplicates,
+  O(n): the middle element becomes the root, recursively. Nodes are created in
+  order, one allocation each. The elements are keys, or (key, mapped) pairs.
+  */
+  template <class InputIt>
+  static BasicBinarySearchTree from_sorted(
+      InputIt first, InputIt last, BalanceMode mode = BalanceMode::kNone,
+      const Compare& compare = Compare()) {
+    BasicBinarySearchTree tree(compare, mode);
+    std::vector<NodeSharedPtr> nodes;
+    for (; first != last; ++first) nodes.push_back(tree.nodeFrom(*first));
+    tree.m_size = nodes.size();
+    tree.m_root = linkBalanced(nodes.data(), nodes.size(), nullptr);
+    return tree;
+  }
+
+  /*
+  Insert a batch of keys (or (key, mapped) pairs) in any order.
+  A small batch goes in one by one, O(k log n). A big one is sorted and merged
+  with the nodes of the tree in order, then the tree is relinked perfectly
+  balanced: O(n + k log k), the existing nodes are reused.
+  Keys already in the tree keep their mapped value, like insert.
+  */
+  template <class InputIt>
+  void bulk_insert(InputIt first, InputIt last) {
+    using Element = typename std::iterator_traits<InputIt>::value_type;
+    std::vector<Element> batch(first, last);
+    if (batch.size() * log2Size() < m_size) {
+      for (auto& element : batch) emplaceElement(element);
+      return;
+    }
+
+    std::stable_sort(batch.begin(), batch.end(),
+                     [this](const Element& lhs, const Element& rhs) {
+                       return m_compare(keyOf(lhs), keyOf(rhs));
+                     });
+    // Merge into a new vector first, the tree stays intact if an allocation
+    // or the comparator throws.
+    std::vector<NodeSharedPtr> old_nodes = nodesInOrder();
+    std::vector<NodeSharedPtr> nodes;
+    nodes.reserve(old_nodes.size() + batch.size());
+    auto old_node = old_nodes.begin();
+    for (auto& element : batch) {
+      const Key& key = keyOf(element);
+      while (old_node != old_nodes.end() &&
+             m_compare((*old_node)->value, key)) {
+        nodes.push_back(std::move(*old_node++));
+      }
+      bool in_tree = old_node != old_nodes.end() &&
+                     !m_compare(key, (*old_node)->value);
+      bool repeated = !nodes.empty() && !m_compare(nodes.back()->value, key);
+      if (!in_tree && !repeated) nodes.push_back(nodeFrom(element));
+    }
+    for (; old_node != old_nodes.end(); ++old_node) {
+      nodes.push_back(std::move(*old_node));
+    }
+    cutChildren(nodes);
+    m_size = nodes.size();
+    m_root = linkBalanced(nodes.data(), nodes.size(), nullptr);
+  }
+
+  /*
+  Remove key, returns the number of keys removed (0 or 1). O(height).
+  A node with two children is replaced by its in order successor, the nodes
+  are relinked and not copied, so iterators to the other keys stay valid.
+  In kAvl mode the ancestors are rebalanced bottom up until a subtree keeps
+  its height, O(log n) rotations at most and no rebuild.
+  */
+  size_t erase(const Key& key) { return eraseKey(key); }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  size_t erase(const K& key) {
+    return eraseKey(key);
+  }
+  // Returns the iterator following the erased key.
+  const_iterator erase(const_iterator position) {
+    const_iterator next = std::next(position);
+    eraseNode(position.node());
+    return next;
+  }
+  /*
+  Erase [first, last), returns last. In kAvl mode key by key, O(k log n) and
+  never more than O(log n) relinking per key. In kNone mode only the smallest
+  subtree holding the range is touched: a range small against that subtree
+  goes key by key, otherwise the kept nodes of the subtree are relinked
+  perfectly balanced, O(subtree size). The rest of the tree keeps its links.
+  */
+  const_iterator erase(const_iterator first, const_iterator last) {
+    if (first == last) return last;
+    size_t count = static_cast<size_t>(std::distance(first, last));
+    Node* top = commonAncestor(first.node(), std::prev(last).node());
+    if (m_mode == BalanceMode::kAvl ||
+        count * log2Of(top->size) < top->size) {
+      while (first != last) first = erase(first);
+      return last;
+    }
+
+    NodeSharedPtr& owner = ownerOf(top);
+    Node* parent = top->parent;
+    std::vector<NodeSharedPtr> nodes = nodesInOrder(owner, top->size);
+    cutChildren(nodes, owner);
+    size_t kept = 0;
+    bool in_range = false;
+    for (auto& node : nodes) {
+      if (node.get() == first.node()) in_range = true;
+      if (node.get() == last.node()) in_range = false;
+      if (in_range) {
+        node->parent = nullptr;
       } else {
-        return false;
+        nodes[kept++] = std::move(node);
       }
     }
+    owner = linkBalanced(nodes.data(), kept, parent);
+    m_size -= count;
+    for (Node* ancestor = parent; ancestor; ancestor = ancestor->parent) {
+      ancestor->size -= count;
+    }
+    return last;
+  }
+
+  // The node holding value, nullptr if there is none.
+  NodeSharedPtr lookup(const Key& value) const { return findOwner(value); }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  NodeSharedPtr lookup(const K& value) const {
+    return findOwner(value);
   }
 
-  BNodeSharedPtr lookup(int value) {
-    auto ptr = m_root;
-    while (ptr != nullptr) {
-      if (value < ptr->value) {
-        ptr = ptr->left;
-      } else if (value > ptr->value) {
-        ptr = ptr->right;
+  /*
+  lookup() for count keys, results[i] points at keys[i] or is end().
+  The searches run interleaved in groups of kBatchGroup: each step moves
+  every unfinished search of the group down one level and prefetches the
+  node it lands on, so up to kBatchGroup cache misses are in flight instead
+  of one. No reference count is touched.
+  */
+  void lookup_batch(const Key* keys, size_t count,
+                    const_iterator* results) const {
+    Node* nodes[kBatchGroup];
+    size_t active[kBatchGroup];  // lanes still searching
+    for (size_t first = 0; first < count; first += kBatchGroup) {
+      size_t lanes = std::min<size_t>(kBatchGroup, count - first);
+      size_t active_count = 0;
+      for (size_t lane = 0; lane < lanes; lane++) {
+        results[first + lane] = end();
+        nodes[lane] = m_root.get();
+        if (nodes[lane]) active[active_count++] = lane;
+      }
+      while (active_count > 0) {
+        for (size_t i = 0; i < active_count;) {
+          size_t lane = active[i];
+          const Key& key = keys[first + lane];
+          Node* node = nodes[lane];
+          if (m_compare(key, node->value)) {
+            node = node->left.get();
+          } else if (m_compare(node->value, key)) {
+            node = node->right.get();
+          } else {
+            results[first + lane] = const_iterator(node, &m_root);
+            node = nullptr;
+          }
+          if (!node) {
+            active[i] = active[--active_count];
+            continue;
+          }
+          prefetch(node);
+          nodes[lane] = node;
+          i++;
+        }
+      }
+    }
+  }
+
+  /*
+  Same meaning as for std::set:
+  lower_bound(x), first key not before x;
+  upper_bound(x), first key after x;
+  equal_range(x), [lower_bound(x), upper_bound(x)), one key at most.
+  */
+  const_iterator lower_bound(const Key& key) const {
+    return lowerBound(key);
+  }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  const_iterator lower_bound(const K& key) const {
+    return lowerBound(key);
+  }
+  const_iterator upper_bound(const Key& key) const {
+    return upperBound(key);
+  }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  const_iterator upper_bound(const K& key) const {
+    return upperBound(key);
+  }
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key& key) const {
+    return {lowerBound(key), upperBound(key)};
+  }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    return {lowerBound(key), upperBound(key)};
+  }
+
+  /*
+  Order statistics from the subtree sizes, O(height) in both modes:
+  select(k), the k-th smallest key (from 0), end() if k >= size();
+  rank(x), number of keys before x;
+  count_range(a, b), number of keys in [a, b).
+  */
+  const_iterator select(size_t k) const {
+    Node* node = m_root.get();
+    while (node) {
+      size_t left = size(node->left);
+      if (k < left) {
+        node = node->left.get();
+      } else if (k > left) {
+        k -= left + 1;
+        node = node->right.get();
       } else {
-        return ptr;
+        break;
+      }
+    }
+    return const_iterator(node, &m_root);
+  }
+  size_t rank(const Key& key) const { return rankOf(key); }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  size_t rank(const K& key) const {
+    return rankOf(key);
+  }
+  size_t count_range(const Key& first, const Key& last) const {
+    return countRange(first, last);
+  }
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  size_t count_range(const K& first, const K& last) const {
+    return countRange(first, last);
+  }
+
+  const_iterator begin() const {
+    Node* node = m_root.get();
+    while (node && node->left) node = node->left.get();
+    return const_iterator(node, &m_root);
+  }
+  const_iterator end() const { return const_iterator(nullptr, &m_root); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  NodeSharedPtr root() { return m_root; }
+  const NodeSharedPtr root() const { return m_root; }
+  BalanceMode balance_mode() const { return m_mode; }
+  key_compare key_comp() const { return m_compare; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // Read-only copy of the keys in a cache friendly layout, O(n).
+  EytzingerTree freeze() const {
+    static_assert(std::is_same<Key, int>::value, "freeze needs int keys");
+    std::vector<int> sorted;
+    std::vector<const Node*> stack;
+    const Node* node = m_root.get();
+    while (node || !stack.empty()) {
+      for (; node; node = node->left.get()) stack.push_back(node);
+      node = stack.back();
+      stack.pop_back();
+      sorted.push_back(node->value);
+      node = node->right.get();
+    }
+    return EytzingerTree(sorted);
+  }
+
+  // Number of levels, 0 for an empty tree. O(n), walks level by level.
+  int height() const {
+    int levels = 0;
+    std::vector<const Node*> level;
+    if (m_root) level.push_back(m_root.get());
+    while (!level.empty()) {
+      levels++;
+      std::vector<const Node*> next_level;
+      for (auto node : level) {
+        if (node->left) next_level.push_back(node->left.get());
+        if (node->right) next_level.push_back(node->right.get());
       }
+      level.swap(next_level);
     }
-    return ptr;
+    return levels;
   }
-  BNodeSharedPtr root() { return m_root; }
-  const BNodeSharedPtr root() const { return m_root; }
 
  private:
-  BNodeSharedPtr createNode(int value) {
-    return std::make_shared<BNode>(value, nullptr, nullptr);
+  template <class K, class... Args>
+  NodeSharedPtr createNode(K&& key, Args&&... args) {
+    return std::make_shared<Node>(std::piecewise_construct,
+                                  std::forward<K>(key),
+                                  std::forward<Args>(args)...);
+  }
+
+  // Copy of the subtree below source with keys, mapped values, heights,
+  // sizes and parent links. Iterative, a degenerated tree is a long list.
+  static NodeSharedPtr copyTree(const Node* source) {
+    NodeSharedPtr root;
+    struct Pending {
+      const Node* source;
+      NodeSharedPtr* slot;
+      Node* parent;
+    };
+    std::vector<Pending> stack;
+    if (source) stack.push_back({source, &root, nullptr});
+    while (!stack.empty()) {
+      Pending next = stack.back();
+      stack.pop_back();
+      NodeSharedPtr node = std::make_shared<Node>(
+          std::piecewise_construct, next.source->value, next.source->mapped);
+      node->parent = next.parent;
+      node->height = next.source->height;
+      node->size = next.source->size;
+      if (next.source->left)
+        stack.push_back({next.source->left.get(), &node->left, node.get()});
+      if (next.source->right)
+        stack.push_back({next.source->right.get(), &node->right, node.get()});
+      *next.slot = std::move(node);
+    }
+    return root;
+  }
+
+  static const Key& keyOf(const Key& key) { return key; }
+  template <class K, class M>
+  static const K& keyOf(const std::pair<K, M>& element) {
+    return element.first;
+  }
+  NodeSharedPtr nodeFrom(const Key& key) { return createNode(key); }
+  template <class K, class M>
+  NodeSharedPtr nodeFrom(const std::pair<K, M>& element) {
+    return createNode(element.first, element.second);
+  }
+  void emplaceElement(const Key& key) { emplaceKey(key); }
+  template <class K, class M>
+  void emplaceElement(const std::pair<K, M>& element) {
+    emplaceKey(element.first, element.second);
+  }
+
+  // Make nodes[0, count) a perfectly balanced subtree below parent, heights
+  // included. The recursion is log2(count) deep.
+  static NodeSharedPtr linkBalanced(NodeSharedPtr* nodes, size_t count,
+                                    Node* parent) {
+    if (count == 0) return nullptr;
+    size_t middle = count / 2;
+    NodeSharedPtr root = std::move(nodes[middle]);
+    root->parent = parent;
+    root->left = linkBalanced(nodes, middle, root.get());
+    root->right =
+        linkBalanced(nodes + middle + 1, count - middle - 1, root.get());
+    updateNode(*root);
+    return root;
+  }
+
+  template <class K>
+  const_iterator lowerBound(const K& key) const {
+    Node* result = nullptr;
+    Node* node = m_root.get();
+    while (node) {
+      if (!m_compare(node->value, key)) {
+        result = node;
+        node = node->left.get();
+      } else {
+        node = node->right.get();
+      }
+    }
+    return const_iterator(result, &m_root);
+  }
+  template <class K>
+  const_iterator upperBound(const K& key) const {
+    Node* result = nullptr;
+    Node* node = m_root.get();
+    while (node) {
+      if (m_compare(key, node->value)) {
+        result = node;
+        node = node->left.get();
+      } else {
+        node = node->right.get();
+      }
+    }
+    return const_iterator(result, &m_root);
+  }
+
+  enum : size_t { kBatchGroup = 16 };
+
+  // The key and both child pointers, they may straddle two cache lines.
+  static void prefetch(const Node* node) {
+#ifdef EYTZINGER_SSE2
+    _mm_prefetch(reinterpret_cast<const char*>(node), _MM_HINT_T0);
+    _mm_prefetch(reinterpret_cast<const char*>(&node->right), _MM_HINT_T0);
+#else
+    (void)node;
+#endif
+  }
+
+  // ceil(log2(size)), at least 1.
+  size_t log2Size() const { return log2Of(m_size); }
+  static size_t log2Of(size_t size) {
+    size_t log_n = 1;
+    while ((size_t(1) << log_n) < size) log_n++;
+    return log_n;
+  }
+
+  // Lowest node with both a and b in its subtree, O(height).
+  static Node* commonAncestor(Node* a, Node* b) {
+    auto depth = [](const Node* node) {
+      size_t levels = 0;
+      for (; node->parent; node = node->parent) levels++;
+      return levels;
+    };
+    size_t depth_a = depth(a);
+    size_t depth_b = depth(b);
+    for (; depth_a > depth_b; depth_a--) a = a->parent;
+    for (; depth_b > depth_a; depth_b--) b = b->parent;
+    while (a != b) {
+      a = a->parent;
+      b = b->parent;
+    }
+    return a;
+  }
+
+  // The pointer in the tree that owns node.
+  NodeSharedPtr& ownerOf(Node* node) {
+    Node* parent = node->parent;
+    if (!parent) return m_root;
+    return parent->left.get() == node ? parent->left : parent->right;
+  }
+
+  template <class K>
+  size_t eraseKey(const K& key) {
+    Node* node = findOwner(key).get();
+    if (!node) return 0;
+    eraseNode(node);
+    return 1;
   }
-  BNodeSharedPtr m_root{nullptr};
+
+  /*
+  Unlink node. With one child at most, the child takes its place. Otherwise
+  the successor (leftmost of the right subtree) is cut out, its right child
+  takes the successor's place, and the successor takes over node's children,
+  parent, height and size. The subtree sizes shrink, and rebalancing starts,
+  at the lowest node that lost a child.
+  */
+  void eraseNode(Node* node) {
+    NodeSharedPtr& owner = ownerOf(node);
+    NodeSharedPtr removed = std::move(owner);
+    Node* lowest_changed = node->parent;
+    if (!node->left || !node->right) {
+      owner = std::move(node->left ? node->left : node->right);
+      if (owner) owner->parent = node->parent;
+    } else {
+      Node* successor = node->right.get();
+      while (successor->left) successor = successor->left.get();
+      lowest_changed = successor->parent == node ? successor
+                                                 : successor->parent;
+      NodeSharedPtr& successor_owner = ownerOf(successor);
+      NodeSharedPtr moved = std::move(successor_owner);
+      successor_owner = std::move(moved->right);
+      if (successor_owner) successor_owner->parent = moved->parent;
+
+      moved->left = std::move(node->left);
+      moved->right = std::move(node->right);
+      moved->left->parent = successor;
+      if (moved->right) moved->right->parent = successor;
+      moved->parent = node->parent;
+      moved->height = node->height;
+      moved->size = node->size;
+      owner = std::move(moved);
+    }
+    removed->parent = nullptr;
+    m_size--;
+    for (Node* ancestor = lowest_changed; ancestor;
+         ancestor = ancestor->parent) {
+      ancestor->size--;
+    }
+
+    if (m_mode != BalanceMode::kAvl) return;
+    while (lowest_changed) {
+      NodeSharedPtr& subtree = ownerOf(lowest_changed);
+      int old_height = subtree->height;
+      rebalance(subtree);
+      if (subtree->height == old_height) break;
+      lowest_changed = subtree->parent;
+    }
+  }
+
+  template <class K>
+  size_t rankOf(const K& key) const {
+    size_t before = 0;
+    const Node* node = m_root.get();
+    while (node) {
+      if (m_compare(node->value, key)) {
+        before += size(node->left) + 1;
+        node = node->right.get();
+      } else {
+        node = node->left.get();
+      }
+    }
+    return before;
+  }
+  template <class K>
+  size_t countRange(const K& first, const K& last) const {
+    if (!m_compare(first, last)) return 0;
+    return rankOf(last) - rankOf(first);
+  }
+
+  // All nodes in order, the tree is left as it is.
+  std::vector<NodeSharedPtr> nodesInOrder() const {
+    return nodesInOrder(m_root, m_size);
+  }
+  // Nodes of the subtree below root in order, count of them.
+  static std::vector<NodeSharedPtr> nodesInOrder(const NodeSharedPtr& root,
+                                                 size_t count) {
+    std::vector<NodeSharedPtr> nodes;
+    nodes.reserve(count);
+    std::vector<const NodeSharedPtr*> stack;
+    const NodeSharedPtr* owner = &root;
+    while (*owner || !stack.empty()) {
+      for (; *owner; owner = &(*owner)->left) stack.push_back(owner);
+      owner = stack.back();
+      stack.pop_back();
+      nodes.push_back(*owner);
+      owner = &(*owner)->right;
+    }
+    return nodes;
+  }
+
+  // Unlink every node of the tree, nodes holds all of them so none dies.
+  // Cannot throw, the step between preparing a rebuild and linking it.
+  void cutChildren(std::vector<NodeSharedPtr>& nodes) noexcept {
+    cutChildren(nodes, m_root);
+  }
+  // Same for the subtree held by owner.
+  static void cutChildren(std::vector<NodeSharedPtr>& nodes,
+                          NodeSharedPtr& owner) noexcept {
+    for (auto& node : nodes) {
+      node->left.reset();
+      node->right.reset();
+    }
+    owner.reset();
+  }
+
+  // The owning pointer of the node with key, or the empty child slot where
+  // it would be. Walks the slots, so no reference count is touched.
+  template <class K>
+  const NodeSharedPtr& findOwner(const K& key) const {
+    const NodeSharedPtr* owner = &m_root;
+    while (*owner) {
+      if (m_compare(key, (*owner)->value)) {
+        owner = &(*owner)->left;
+      } else if (m_compare((*owner)->value, key)) {
+        owner = &(*owner)->right;
+      } else {
+        break;
+      }
+    }
+    return *owner;
+  }
+
+  /*
+  Walk down the owning pointers and hang the new node into the empty slot,
+  then grow the subtree sizes of its ancestors.
+  In kAvl mode the slots on the way are kept, so the heights can be fixed
+  bottom up. One single or double rotation restores the balance, after it
+  the subtree has its old height and the walk stops.
+  */
+  template <class K, class... Args>
+  std::pair<NodeSharedPtr, bool> emplaceKey(K&& key, Args&&... args) {
+    std::vector<NodeSharedPtr*> path;
+    NodeSharedPtr* owner = &m_root;
+    Node* parent = nullptr;
+    while (*owner) {
+      if (m_mode == BalanceMode::kAvl) path.push_back(owner);
+      parent = owner->get();
+      if (m_compare(key, (*owner)->value)) {
+        owner = &(*owner)->left;
+      } else if (m_compare((*owner)->value, key)) {
+        owner = &(*owner)->right;
+      } else {
+        return {*owner, false};
+      }
+    }
+    *owner = createNode(std::forward<K>(key), std::forward<Args>(args)...);
+    NodeSharedPtr new_node = *owner;
+    new_node->parent = parent;
+    m_size++;
+    for (Node* ancestor = parent; ancestor; ancestor = ancestor->parent) {
+      ancestor->size++;
+    }
+
+    for (auto it = path.rbegin(); it != path.rend(); it++) {
+      NodeSharedPtr& node = **it;
+      int old_height = node->height;
+      rebalance(node);
+      if (node->height == old_height) break;
+    }
+    return {new_node, true};
+  }
+
+  static int height(const NodeSharedPtr& node) {
+    return node ? node->height : 0;
+  }
+  static size_t size(const NodeSharedPtr& node) {
+    return node ? node->size : 0;
+  }
+  // Height and subtree size from the children.
+  static void updateNode(Node& node) {
+    node.height = 1 + std::max(height(node.left), height(node.right));
+    node.size = 1 + size(node.left) + size(node.right);
+  }
+
+  /*
+      node          pivot
+     /    \         /    \
+   pivot   c  =>   a    node
+   /   \                /   \
+  a     b              b     c
+  */
+  static void rotateRight(NodeSharedPtr& node) {
+    NodeSharedPtr pivot = std::move(node->left);
+    pivot->parent = node->parent;
+    node->parent = pivot.get();
+    node->left = std::move(pivot->right);
+    if (node->left) node->left->parent = node.get();
+    updateNode(*node);
+    pivot->right = std::move(node);
+    updateNode(*pivot);
+    node = std::move(pivot);
+  }
+  static void rotateLeft(NodeSharedPtr& node) {
+    NodeSharedPtr pivot = std::move(node->right);
+    pivot->parent = node->parent;
+    node->parent = pivot.get();
+    node->right = std::move(pivot->left);
+    if (node->right) node->right->parent = node.get();
+    updateNode(*node);
+    pivot->left = std::move(node);
+    updateNode(*pivot);
+    node = std::move(pivot);
+  }
+
+  static void rebalance(NodeSharedPtr& node) {
+    updateNode(*node);
+    int balance = height(node->left) - height(node->right);
+    if (balance > 1) {
+      if (height(node->left->left) < height(node->left->right))
+        rotateLeft(node->left);
+      rotateRight(node);
+    } else if (balance < -1) {
+      if (height(node->right->right) < height(node->right->left))
+        rotateRight(node->right);
+      rotateLeft(node);
+    }
+  }
+
+  NodeSharedPtr m_root{nullptr};
+  size_t m_size{0};
+  Compare m_compare;
+  BalanceMode m_mode{BalanceMode::kNone};
 };
+
+using BinarySearchTree = BasicBinarySearchTree<int>;
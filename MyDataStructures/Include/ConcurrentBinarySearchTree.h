@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <random>
+#include <thread>
+#include "Node.h"
+
+/*
+Ordered set shared by many threads, insert and lookup only.
+A binary tree stays O(log n) deep only if it rotates, and a rotation moves
+nodes under the readers. So the keys are kept in a lock-free skip list: its
+depth comes from random node levels, not from the key order, and is
+O(log n) expected for sorted ids as well. Nodes never move.
+
+level 2: head ----------------------> {40}
+level 1: head -------> {20} --------> {40}
+level 0: head -> {10} -> {20} -> {30} -> {40}
+
+insert links a new node on level 0 with one compare-and-swap, that makes it
+a member; if another thread changed the link first, the search is redone.
+The upper levels are linked the same way afterwards, they only make
+searches faster. Published nodes are never changed (only their links) or
+freed before the tree dies, so lookup takes no lock and needs no hazard
+pointers or validation, an acquire load per step is enough.
+*/
+template <class Key, class Compare = std::less<Key>>
+class ConcurrentBinarySearchTree {
+ public:
+  using Node = ConcurrentSkipNode<Key>;
+  using key_type = Key;
+  enum : size_t { kMaxLevel = 32 };
+
+  ConcurrentBinarySearchTree() {
+    for (auto& link : m_head) link.store(nullptr);
+  }
+  ConcurrentBinarySearchTree(std::initializer_list<Key> list)
+      : ConcurrentBinarySearchTree() {
+    for (auto it = list.begin(); it != list.end(); it++) {
+      insert(*it);
+    }
+  }
+  ConcurrentBinarySearchTree(const ConcurrentBinarySearchTree&) = delete;
+  ConcurrentBinarySearchTree& operator=(const ConcurrentBinarySearchTree&) =
+      delete;
+  ~ConcurrentBinarySearchTree() {
+    // no other thread may use the tree any more, every node is on level 0.
+    Node* node = m_head[0].load();
+    while (node) {
+      Node* next = node->next[0].load();
+      Node::destroy(node);
+      node = next;
+    }
+  }
+
+  // Lock-free, false if the key is already there.
+  bool insert(const Key& key) {
+    std::atomic<Node*>* preds[kMaxLevel];
+    Node* succs[kMaxLevel];
+    if (find(key, preds, succs)) return false;
+
+    Node* new_node = Node::create(key, randomLevel());
+    while (true) {
+      new_node->next[0].store(succs[0], std::memory_order_relaxed);
+      // release: the key and the links are visible before the node is
+      // reachable.
+      if (preds[0]->compare_exchange_strong(succs[0], new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+      if (find(key, preds, succs)) {
+        Node::destroy(new_node);
+        return false;
+      }
+    }
+    m_size.fetch_add(1, std::memory_order_relaxed);
+
+    // Only this thread writes new_node->next[level] until the node is linked
+    // on that level, the search never finds it there before.
+    for (size_t level = 1; level < new_node->levels; level++) {
+      while (true) {
+        new_node->next[level].store(succs[level], std::memory_order_relaxed);
+        if (preds[level]->compare_exchange_strong(succs[level], new_node,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+          break;
+        }
+        find(key, preds, succs);
+      }
+    }
+    return true;
+  }
+
+  // Lock-free, the stored key or nullptr. O(log n) expected.
+  const Key* lookup(const Key& key) const {
+    const std::atomic<Node*>* links = m_head;
+    for (size_t level = kMaxLevel; level-- > 0;) {
+      Node* node = links[level].load(std::memory_order_acquire);
+      while (node && m_compare(node->value, key)) {
+        links = node->next;
+        node = links[level].load(std::memory_order_acquire);
+      }
+      if (node && !m_compare(key, node->value)) return &node->value;
+    }
+    return nullptr;
+  }
+  bool contains(const Key& key) const { return lookup(key) != nullptr; }
+
+  size_t size() const { return m_size.load(std::memory_order_relaxed); }
+  bool empty() const { return size() == 0; }
+
+ private:
+  // On every level the link to the first node not before key (succs) and
+  // the link slot pointing to it (preds). true if that node holds key.
+  bool find(const Key& key, std::atomic<Node*>** preds, Node** succs) {
+    std::atomic<Node*>* links = m_head;
+    for (size_t level = kMaxLevel; level-- > 0;) {
+      Node* node = links[level].load(std::memory_order_acquire);
+      while (node && m_compare(node->value, key)) {
+        links = node->next;
+        node = links[level].load(std::memory_order_acquire);
+      }
+      preds[level] = &links[level];
+      succs[level] = node;
+    }
+    return succs[0] && !m_compare(key, succs[0]->value);
+  }
+
+  // 1 + number of heads in a row, one node in 2^k reaches level k.
+  static size_t randomLevel() {
+    thread_local std::minstd_rand random(static_cast<unsigned>(
+        std::hash<std::thread::id>()(std::this_thread::get_id())));
+    size_t level = 1;
+    while (level < kMaxLevel && (random() & 1)) level++;
+    return level;
+  }
+
+  std::atomic<Node*> m_head[kMaxLevel];
+  std::atomic<size_t> m_size{0};
+  Compare m_compare;
+};
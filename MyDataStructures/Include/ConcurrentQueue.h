@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <atomic>
+#include <utility>
+#include "HazardPointer.h"
+#include "Node.h"
+
+/*
+Lock-free multi producer multi consumer queue (Michael & Scott).
+m_head always points to a dummy node, the front value is in m_head->next.
+Dequeued dummies are retired through hazard pointers, so a node is never
+deleted while another thread still reads it.
+
+head(dummy) -> {1} -> {2} -> {3} <- tail
+
+T has to be default constructible (dummy node) and copyable (pop).
+*/
+template <class T>
+class ConcurrentQueue {
+ public:
+  using Node = QueueNode<T>;
+
+  ConcurrentQueue() {
+    auto dummy = new Node();
+    m_head.store(dummy);
+    m_tail.store(dummy);
+  }
+  ConcurrentQueue(const ConcurrentQueue&) = delete;
+  ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+  ~ConcurrentQueue() {
+    // no other thread may use the queue any more.
+    Node* node = m_head.load();
+    while (node) {
+      Node* next = node->next.load();
+      delete node;
+      node = next;
+    }
+  }
+
+  void push(const T& value) { emplace(value); }
+  void push(T&& value) { emplace(std::move(value)); }
+
+  template <class... Args>
+  void emplace(Args&&... args) {
+    Node* node = new Node(std::forward<Args>(args)...);
+    auto& hazards = HazardPointer::thisThread();
+
+    while (true) {
+      Node* tail = hazards.protect(0, m_tail);
+      Node* next = tail->next.load();
+      if (tail != m_tail.load()) continue;
+
+      if (next != nullptr) {
+        // tail is behind, help the other producer and retry.
+        m_tail.compare_exchange_weak(tail, next);
+        continue;
+      }
+      if (tail->next.compare_exchange_weak(next, node)) {
+        m_tail.compare_exchange_strong(tail, node);
+        hazards.clear();
+        return;
+      }
+    }
+  }
+
+  // Copy the front value into value and remove it, false if empty.
+  bool pop(T& value) {
+    auto& hazards = HazardPointer::thisThread();
+
+    while (true) {
+      Node* head = hazards.protect(0, m_head);
+      Node* tail = m_tail.load();
+      Node* next = hazards.protect(1, head->next);
+      // next can only be retired after head, head is still in the queue.
+      if (head != m_head.load()) continue;
+
+      if (next == nullptr) {
+        hazards.clear();
+        return false;
+      }
+      if (head == tail) {
+        m_tail.compare_exchange_weak(tail, next);
+        continue;
+      }
+
+      // Copy before the CAS, once it succeeds another consumer may own next.
+      value = next->value;
+      if (m_head.compare_exchange_weak(head, next)) {
+        hazards.clear();
+        hazards.retire(head);
+        return true;
+      }
+    }
+  }
+
+  bool empty() const {
+    auto& hazards = HazardPointer::thisThread();
+    bool res = hazards.protect(0, m_head)->next.load() == nullptr;
+    hazards.clear();
+    return res;
+  }
+
+ private:
+  std::atomic<Node*> m_head;
+  std::atomic<Node*> m_tail;
+};
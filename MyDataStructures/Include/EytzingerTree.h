@@ -0,0 +1,167 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EYTZINGER_SSE2 1
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+Read-only sorted set of ints in Eytzinger (BFS) order:
+keys[1] is the root, the children of keys[k] are keys[2k] and keys[2k + 1].
+
+sorted: 0 1 2 3 4 5 6    =>    keys: _ 3 1 5 0 2 4 6
+
+The top levels share a few cache lines, and the 16 descendants four levels
+below k are keys[16k .. 16k + 15], one 64 byte line which is prefetched while
+the current level is compared. The descent has no data dependent branch:
+k = 2k + (keys[k] < x). The array is shared between copies.
+*/
+class EytzingerTree {
+ public:
+  EytzingerTree() = default;
+  // values must be sorted and unique.
+  explicit EytzingerTree(const std::vector<int>& sorted)
+      : m_size(sorted.size()) {
+    // one spare line in front so keys can start on a 64 byte boundary
+    m_storage.reset(new int[m_size + 1 + kLineInts],
+                    std::default_delete<int[]>());
+    auto address = reinterpret_cast<uintptr_t>(m_storage.get());
+    m_keys = reinterpret_cast<int*>((address + kLineBytes - 1) /
+                                    kLineBytes * kLineBytes);
+    size_t next = 0;
+    fill(sorted, 1, next);
+    while ((size_t(2) << m_full_levels) - 1 <= m_size) m_full_levels++;
+  }
+
+  // First key not less than x, nullptr if there is none.
+  const int* lower_bound(int x) const {
+    if (m_size == 0) return nullptr;
+    size_t k = 1;
+    for (size_t level = 0; level < m_full_levels; level++) {
+      prefetch(k);
+      k = 2 * k + (m_keys[k] < x);
+    }
+    return finish(k, x);
+  }
+  const int* lookup(int x) const {
+    const int* key = lower_bound(x);
+    return key && *key == x ? key : nullptr;
+  }
+  bool contains(int x) const { return lookup(x) != nullptr; }
+
+  /*
+  lookup() for count queries, results[i] is lookup(queries[i]).
+  With SSE2 four descents run side by side, one compare and index update for
+  all of them per level, and their loads overlap in memory.
+  */
+  void lookup_batch(const int* queries, size_t count,
+                    const int** results) const {
+    size_t i = 0;
+#ifdef EYTZINGER_SSE2
+    // the lanes hold 32 bit indices
+    if (m_size < (size_t(1) << 30)) {
+      for (; i + 4 <= count; i += 4) lookup4(queries + i, results + i);
+    }
+#endif
+    for (; i < count; i++) results[i] = lookup(queries[i]);
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  // Eytzinger ordered keys, data()[1] is the root.
+  const int* data() const { return m_keys; }
+
+ private:
+  enum : size_t { kLineBytes = 64, kLineInts = kLineBytes / sizeof(int) };
+
+  // In order walk over the implicit tree, depth is log2(n).
+  void fill(const std::vector<int>& sorted, size_t k, size_t& next) {
+    if (k > m_size) return;
+    fill(sorted, 2 * k, next);
+    m_keys[k] = sorted[next++];
+    fill(sorted, 2 * k + 1, next);
+  }
+
+  // Last, partial level, then drop the trailing right turns (1 bits) and the
+  // left turn before them to get back to the answer; 0 means none.
+  const int* finish(size_t k, int x) const {
+    if (k <= m_size) k = 2 * k + (m_keys[k] < x);
+    k >>= countTrailingZeros(~k) + 1;
+    return k ? m_keys + k : nullptr;
+  }
+
+  void prefetch(size_t k) const {
+#ifdef EYTZINGER_SSE2
+    // may point past the end, a prefetch never faults
+    auto line = reinterpret_cast<uintptr_t>(m_keys) + k * kLineBytes;
+    _mm_prefetch(reinterpret_cast<const char*>(line), _MM_HINT_T0);
+#else
+    (void)k;
+#endif
+  }
+
+  static unsigned countTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _M_X64
+    _BitScanForward64(&index, value);
+#else
+    if (!_BitScanForward(&index, static_cast<unsigned long>(value))) {
+      _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+      index += 32;
+    }
+#endif
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+  }
+
+#ifdef EYTZINGER_SSE2
+  void lookup4(const int* queries, const int** results) const {
+    if (m_size == 0) {
+      for (int lane = 0; lane < 4; lane++) results[lane] = nullptr;
+      return;
+    }
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(queries));
+    __m128i k = _mm_set1_epi32(1);
+    for (size_t level = 0; level < m_full_levels; level++) {
+      // lanes out through registers, a store + reload stalls on forwarding
+      size_t k0 = static_cast<uint32_t>(_mm_cvtsi128_si32(k));
+      size_t k1 = static_cast<uint32_t>(
+          _mm_cvtsi128_si32(_mm_shuffle_epi32(k, _MM_SHUFFLE(1, 1, 1, 1))));
+      size_t k2 = static_cast<uint32_t>(
+          _mm_cvtsi128_si32(_mm_shuffle_epi32(k, _MM_SHUFFLE(2, 2, 2, 2))));
+      size_t k3 = static_cast<uint32_t>(
+          _mm_cvtsi128_si32(_mm_shuffle_epi32(k, _MM_SHUFFLE(3, 3, 3, 3))));
+      prefetch(k0);
+      prefetch(k1);
+      prefetch(k2);
+      prefetch(k3);
+      __m128i key = _mm_set_epi32(m_keys[k3], m_keys[k2], m_keys[k1],
+                                  m_keys[k0]);
+      // k = 2k + (key < x), the compare gives -1 for true
+      k = _mm_sub_epi32(_mm_add_epi32(k, k), _mm_cmplt_epi32(key, x));
+    }
+    alignas(16) uint32_t index[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(index), k);
+    for (int lane = 0; lane < 4; lane++) {
+      const int* found = finish(index[lane], queries[lane]);
+      results[lane] = found && *found == queries[lane] ? found : nullptr;
+    }
+  }
+#endif
+
+  std::shared_ptr<int> m_storage;
+  int* m_keys{nullptr};
+  size_t m_size{0};
+  size_t m_full_levels{0};  // levels without holes, floor(log2(n + 1))
+};
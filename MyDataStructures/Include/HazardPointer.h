@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/*
+Hazard pointers for lock-free containers.
+A thread publishes the node it is about to read in one of its hazard slots.
+A removed node is retired instead of deleted, and it is only deleted once no
+thread publishes it any more.
+*/
+namespace HazardPointer {
+const size_t kMaxThreads = 128;
+const size_t kSlotsPerThread = 2;
+// Scan the hazards once this many nodes are waiting in a thread.
+const size_t kScanThreshold = 2 * kMaxThreads * kSlotsPerThread;
+
+struct Record {
+  std::atomic<bool> active{false};
+  std::atomic<void*> slots[kSlotsPerThread];
+};
+
+struct Retired {
+  void* ptr;
+  void (*deleter)(void*);
+};
+
+class Domain {
+ public:
+  Domain() {
+    for (auto& record : m_records) {
+      for (auto& slot : record.slots) slot.store(nullptr);
+    }
+  }
+  ~Domain() {
+    // no thread is alive any more, nothing can be protected.
+    for (auto& node : m_orphans) node.deleter(node.ptr);
+  }
+
+  Record* acquire() {
+    for (auto& record : m_records) {
+      bool expected = false;
+      if (record.active.compare_exchange_strong(expected, true)) {
+        return &record;
+      }
+    }
+    throw std::runtime_error("HazardPointer: too many threads");
+  }
+
+  void release(Record* record) {
+    for (auto& slot : record->slots) slot.store(nullptr);
+    record->active.store(false);
+  }
+
+  // Delete the retired nodes which no thread protects, keep the others.
+  void scan(std::vector<Retired>& retired) {
+    {
+      // adopt the nodes left behind by finished threads before reading the
+      // hazards, every node must be retired before the scan that frees it.
+      std::lock_guard<std::mutex> lock(m_orphans_mutex);
+      retired.insert(retired.end(), m_orphans.begin(), m_orphans.end());
+      m_orphans.clear();
+    }
+
+    std::vector<void*> hazards;
+    for (auto& record : m_records) {
+      for (auto& slot : record.slots) {
+        if (void* ptr = slot.load()) hazards.push_back(ptr);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    auto protected_end = std::partition(
+        retired.begin(), retired.end(), [&hazards](const Retired& node) {
+          return std::binary_search(hazards.begin(), hazards.end(), node.ptr);
+        });
+    for (auto it = protected_end; it != retired.end(); it++) {
+      it->deleter(it->ptr);
+    }
+    retired.erase(protected_end, retired.end());
+  }
+
+  void orphan(std::vector<Retired>& retired) {
+    std::lock_guard<std::mutex> lock(m_orphans_mutex);
+    m_orphans.insert(m_orphans.end(), retired.begin(), retired.end());
+    retired.clear();
+  }
+
+ private:
+  Record m_records[kMaxThreads];
+  std::mutex m_orphans_mutex;
+  std::vector<Retired> m_orphans;
+};
+
+inline Domain& domain() {
+  static Domain instance;
+  return instance;
+}
+
+// Hazard record and retired nodes of the calling thread.
+class ThreadState {
+ public:
+  ThreadState() : m_domain(domain()), m_record(m_domain.acquire()) {}
+  ~ThreadState() {
+    m_domain.release(m_record);
+    m_domain.scan(m_retired);
+    if (!m_retired.empty()) m_domain.orphan(m_retired);
+  }
+
+  // Publish the pointer loaded from src in slot, until it is stable.
+  template <class N>
+  N* protect(size_t slot, const std::atomic<N*>& src) {
+    N* ptr = src.load();
+    while (true) {
+      m_record->slots[slot].store(ptr);
+      N* again = src.load();
+      if (again == ptr) return ptr;
+      ptr = again;
+    }
+  }
+
+  void clear() {
+    for (auto& slot : m_record->slots) slot.store(nullptr);
+  }
+
+  template <class N>
+  void retire(N* node) {
+    m_retired.push_back({node, [](void* ptr) { delete static_cast<N*>(ptr); }});
+    if (m_retired.size() >= kScanThreshold) m_domain.scan(m_retired);
+  }
+
+ private:
+  Domain& m_domain;
+  Record* m_record;
+  std::vector<Retired> m_retired;
+};
+
+inline ThreadState& thisThread() {
+  thread_local ThreadState state;
+  return state;
+}
+}  // namespace HazardPointer
@@ -0,0 +1,199 @@
+﻿#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+
+/*
+Indexable skip list: positional at/insert/erase in O(log n) expected.
+Every link remembers its width, the number of level-0 steps it skips, so a
+lookup by index adds widths while it goes right and down.
+
+level 2: head ----------------4----------------> {40}
+level 1: head -------2-------> {20} -----2-----> {40}
+level 0: head -1-> {10} -1-> {20} -1-> {30} -1-> {40}
+*/
+template <class T>
+class IndexableSkipList {
+ public:
+  enum : size_t { kMaxLevel = 32 };
+
+  struct SkipNode {
+    struct Link {
+      SkipNode* next;
+      size_t width;
+    };
+
+    template <class... Args>
+    SkipNode(size_t level, Args&&... args)
+        : value(std::forward<Args>(args)...), links(level, Link{nullptr, 1}) {}
+
+    T value;
+    std::vector<Link> links;
+  };
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+    explicit const_iterator(const SkipNode* node) : m_node(node) {}
+
+    reference operator*() const { return m_node->value; }
+    pointer operator->() const { return &m_node->value; }
+    const_iterator& operator++() {
+      m_node = m_node->links[0].next;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return m_node == rhs.m_node;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return m_node != rhs.m_node;
+    }
+
+   private:
+    const SkipNode* m_node{nullptr};
+  };
+  using iterator = const_iterator;
+  using value_type = T;
+
+  IndexableSkipList() : m_head(kMaxLevel, {nullptr, 1}) {}
+  IndexableSkipList(std::initializer_list<T> v) : IndexableSkipList() {
+    for (auto it = v.begin(); it != v.end(); it++) {
+      push_back(*it);
+    }
+  }
+  IndexableSkipList(const IndexableSkipList&) = delete;
+  IndexableSkipList& operator=(const IndexableSkipList&) = delete;
+  ~IndexableSkipList() { clear(); }
+
+  void push_back(const T& value) { insert(m_length, value); }
+  void push_front(const T& value) { insert(0, value); }
+
+  /*
+  {0 1 3 4}
+  insert (2,10) // insert to index 2
+  {0 1 10 3 4}
+  */
+  void insert(size_t index, const T& value) { emplace(index, value); }
+
+  template <class... Args>
+  void emplace(size_t index, Args&&... args) {
+    if (index > m_length) index = m_length;  // just add at the end.
+
+    // update[l] are the links of the last node on level l before the new
+    // position, position[l] its position. head is 0, element i is i+1.
+    Links* update[kMaxLevel];
+    size_t position[kMaxLevel];
+    findPredecessors(index, update, position);
+
+    size_t level = randomLevel();
+    auto node = new SkipNode(level, std::forward<Args>(args)...);
+    for (size_t l = 0; l < kMaxLevel; l++) {
+      auto& link = (*update[l])[l];
+      if (l < level) {
+        size_t before = index - position[l];  // steps from update to new
+        node->links[l] = {link.next, link.width - before};
+        link = {node, before + 1};
+      } else {
+        link.width++;
+      }
+    }
+    m_length++;
+  }
+
+  void erase(size_t index) {
+    if (index >= m_length) return;
+
+    Links* update[kMaxLevel];
+    size_t position[kMaxLevel];
+    findPredecessors(index, update, position);
+
+    SkipNode* node = (*update[0])[0].next;
+    for (size_t l = 0; l < kMaxLevel; l++) {
+      auto& link = (*update[l])[l];
+      if (link.next == node) {
+        link = {node->links[l].next, link.width + node->links[l].width - 1};
+      } else {
+        link.width--;
+      }
+    }
+    delete node;
+    m_length--;
+  }
+
+  T& at(size_t index) { return nodeAt(index)->value; }
+  const T& at(size_t index) const { return nodeAt(index)->value; }
+  size_t size() const { return m_length; }
+  bool empty() const { return m_length == 0; }
+
+  void clear() {
+    SkipNode* node = m_head[0].next;
+    while (node) {
+      SkipNode* next = node->links[0].next;
+      delete node;
+      node = next;
+    }
+    for (auto& link : m_head) link = {nullptr, 1};
+    m_length = 0;
+  }
+
+  const_iterator begin() const { return const_iterator(m_head[0].next); }
+  const_iterator end() const { return const_iterator(); }
+
+ private:
+  using Links = std::vector<typename SkipNode::Link>;
+
+  // Walk right and down, stop on every level before position target.
+  void findPredecessors(size_t target, Links** update, size_t* position) {
+    Links* links = &m_head;
+    size_t pos = 0;
+    for (size_t l = kMaxLevel; l-- > 0;) {
+      while ((*links)[l].next && pos + (*links)[l].width <= target) {
+        pos += (*links)[l].width;
+        links = &(*links)[l].next->links;
+      }
+      update[l] = links;
+      position[l] = pos;
+    }
+  }
+
+  SkipNode* nodeAt(size_t index) const {
+    // element index is at position index + 1
+    const Links* links = &m_head;
+    SkipNode* node = nullptr;
+    size_t pos = 0;
+    for (size_t l = kMaxLevel; l-- > 0;) {
+      while ((*links)[l].next && pos + (*links)[l].width <= index + 1) {
+        pos += (*links)[l].width;
+        node = (*links)[l].next;
+        links = &node->links;
+      }
+      if (pos == index + 1) break;
+    }
+    return node;
+  }
+
+  size_t randomLevel() {
+    size_t level = 1;
+    while (level < kMaxLevel && (m_random() & 1)) level++;
+    return level;
+  }
+
+ private:
+  Links m_head;  // links of the head, it holds no value
+  size_t m_length{0};
+  std::minstd_rand m_random;
+};
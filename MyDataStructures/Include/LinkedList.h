@@ -1,46 +1,246 @@
 ﻿#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <functional>
-// #include <utility>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "Node.h"
+#include "NodePool.h"
 
-class LinkedList {
+/*
+Bidirectional iterator over ListNode<T>.
+It keeps a raw node pointer, so ++ does no refcount work. end() is one past
+the tail (nullptr), --end() goes back to the tail through the list's m_tail.
+*/
+template <class T, bool Const>
+class ListIterator {
+ public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = typename std::conditional<Const, const T*, T*>::type;
+  using reference = typename std::conditional<Const, const T&, T&>::type;
+
+  ListIterator() = default;
+  ListIterator(ListNode<T>* node, const std::shared_ptr<ListNode<T>>* tail)
+      : m_node(node), m_tail(tail) {}
+  // iterator converts to const_iterator
+  template <bool C = Const, class = typename std::enable_if<C>::type>
+  ListIterator(const ListIterator<T, false>& rhs)
+      : m_node(rhs.node()), m_tail(rhs.tail()) {}
+
+  reference operator*() const { return m_node->value; }
+  pointer operator->() const { return &m_node->value; }
+
+  ListIterator& operator++() {
+    m_node = m_node->next.get();
+    return *this;
+  }
+  ListIterator operator++(int) {
+    auto temp = *this;
+    ++*this;
+    return temp;
+  }
+  ListIterator& operator--() {
+    m_node = m_node ? m_node->prev : m_tail->get();
+    return *this;
+  }
+  ListIterator operator--(int) {
+    auto temp = *this;
+    --*this;
+    return temp;
+  }
+
+  ListNode<T>* node() const { return m_node; }
+  const std::shared_ptr<ListNode<T>>* tail() const { return m_tail; }
+
+ private:
+  ListNode<T>* m_node{nullptr};
+  const std::shared_ptr<ListNode<T>>* m_tail{nullptr};
+};
+
+// iterator and const_iterator compare with each other, like std::list's.
+template <class T, bool A, bool B>
+bool operator==(const ListIterator<T, A>& lhs, const ListIterator<T, B>& rhs) {
+  return lhs.node() == rhs.node();
+}
+template <class T, bool A, bool B>
+bool operator!=(const ListIterator<T, A>& lhs, const ListIterator<T, B>& rhs) {
+  return lhs.node() != rhs.node();
+}
+
+/*
+Doubly linked list of T. Nodes are shared_ptr owned and allocated with
+Allocator rebound to the node type, by default from a NodePool.
+The list owns the pools its nodes come from, the allocator only points to
+one, so node handles (head(), node_at(), ...) must not outlive the list.
+LinkedList is the int list, like std::string is basic_string<char>.
+*/
+template <class T, class Allocator = PoolAllocator<T>>
+class BasicLinkedList {
  public:
-  LinkedList() {}
-  LinkedList(int value) { add_first_item(value); }
-  LinkedList(std::initializer_list<int> v) {
-    for (auto it = v.begin(); it != v.end(); it++) {
-      push_back(*it);
+  using value_type = T;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using iterator = ListIterator<T, false>;
+  using const_iterator = ListIterator<T, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using NodeSharedPtr = std::shared_ptr<ListNode<T>>;
+  using allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<ListNode<T>>;
+  // SFINAE guard, keeps (first, last) overloads away from (count, value) ones.
+  template <class InputIt>
+  using RequireInputIterator = typename std::enable_if<std::is_convertible<
+      typename std::iterator_traits<InputIt>::iterator_category,
+      std::input_iterator_tag>::value>::type;
+  // Shorter segments are not worth a thread in the parallel_* operations.
+  enum : size_t { kMinParallelSegment = 4096 };
+
+  BasicLinkedList() {}
+  BasicLinkedList(const T& value) { add_first_item(value); }
+  BasicLinkedList(std::initializer_list<T> v) { append_range(v); }
+  template <class InputIt, class = RequireInputIterator<InputIt>>
+  BasicLinkedList(InputIt first, InputIt last) {
+    insert(cend(), first, last);
+  }
+  // Copies are deep, every element is copied into nodes of the new list.
+  BasicLinkedList(const BasicLinkedList& rhs)
+      : m_allocator(std::allocator_traits<allocator_type>::
+                        select_on_container_copy_construction(
+                            rhs.m_allocator)) {
+    insert(cend(), rhs.begin(), rhs.end());
+  }
+  // Moves take over the nodes, the pools and the allocator, rhs is left
+  // empty and gets a new pool with its next node.
+  BasicLinkedList(BasicLinkedList&& rhs) noexcept
+      : m_head(std::move(rhs.m_head)),
+        m_tail(std::move(rhs.m_tail)),
+        m_length(rhs.m_length),
+        m_pools(std::move(rhs.m_pools)),
+        m_allocator(rhs.m_allocator) {
+    rhs.m_length = 0;
+    rhs.m_pools.clear();
+    detachPool(rhs.m_allocator);
+    rhs.invalidateFinger();
+  }
+  // Copy and swap, the list is unchanged if copying an element throws.
+  BasicLinkedList& operator=(const BasicLinkedList& rhs) {
+    if (this == &rhs) return *this;
+    BasicLinkedList copy(rhs);
+    swap(copy);
+    return *this;
+  }
+  BasicLinkedList& operator=(BasicLinkedList&& rhs) noexcept {
+    if (this == &rhs) return *this;
+    BasicLinkedList moved(std::move(rhs));
+    swap(moved);
+    return *this;
+  }
+  ~BasicLinkedList() { clear(); }
+
+  void swap(BasicLinkedList& rhs) noexcept {
+    using std::swap;
+    swap(m_head, rhs.m_head);
+    swap(m_tail, rhs.m_tail);
+    swap(m_length, rhs.m_length);
+    swap(m_pools, rhs.m_pools);
+    swap(m_allocator, rhs.m_allocator);
+    invalidateFinger();
+    rhs.invalidateFinger();
+  }
+
+  void clear() {
+    // Unlink the nodes one by one, otherwise ~Node recurses once per element.
+    // Nodes still held by a node handle, e.g. from head(), are left alone.
+    invalidateFinger();
+    m_tail.reset();
+    m_length = 0;
+    auto ptr = std::move(m_head);
+    while (ptr && ptr.use_count() == 1) {
+      ptr = std::move(ptr->next);
     }
   }
 
-  void push_back(int value) {
+  /*
+  Bulk building: the new nodes are linked into a detached chain in one pass,
+  with the pool reserved up front when the length of the range is known,
+  and the chain is spliced in at the end. The list is unchanged if
+  constructing an element throws.
+  */
+  template <class InputIt, class = RequireInputIterator<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    NodeSharedPtr front, back;
+    size_t count = buildChain(first, last, front, back);
+    clear();
+    if (count) linkRange(cend(), front, back, count);
+  }
+
+  template <class Range>
+  void append_range(const Range& range) {
+    using std::begin;
+    using std::end;
+    insert(cend(), begin(range), end(range));
+  }
+
+  // Returns the first inserted element, or pos for an empty range.
+  template <class InputIt, class = RequireInputIterator<InputIt>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    NodeSharedPtr front, back;
+    size_t count = buildChain(first, last, front, back);
+    if (count == 0) return iterator(pos.node(), &m_tail);
+    linkRange(pos, front, back, count);
+    return iterator(front.get(), &m_tail);
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  template <class... Args>
+  void emplace_back(Args&&... args) {
     if (empty()) {
-      add_first_item(value);
+      add_first_item(std::forward<Args>(args)...);
       return;
     }
 
     // get the current tail
 
-    auto new_node = createNode(value);
+    auto new_node = createNode(std::forward<Args>(args)...);
+    new_node->prev = m_tail.get();
     m_tail->next = new_node;
 
     updateTail(new_node);
     m_length++;
   };
 
-  void push_front(int value) {
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  template <class... Args>
+  void emplace_front(Args&&... args) {
     if (empty()) {
-      add_first_item(value);
+      add_first_item(std::forward<Args>(args)...);
       return;
     }
 
     // get the current tail
 
-    auto new_node = createNode(value);
+    auto new_node = createNode(std::forward<Args>(args)...);
     new_node->next = m_head;
+    m_head->prev = new_node.get();
 
     updateHead(new_node);
     m_length++;
+    if (m_finger) m_finger_index++;  // every index moves one up
   };
 
   void pop_back() {
@@ -48,6 +248,8 @@ class LinkedList {
       return;
     }
 
+    if (m_finger == m_tail.get()) invalidateFinger();
+
     // if head tail are pointing to same node.
     if (m_head == m_tail) {
       m_head.reset();
@@ -58,15 +260,9 @@ class LinkedList {
       return;
     }
 
-    // get the current tail
-    auto ptr = head();
-    while (ptr->next != m_tail) {
-      ptr = ptr->next;
-    }
-
-    // delete ptr->next.get();
+    // O(1), the node before the tail is known through prev.
+    auto ptr = sharedNode(m_tail->prev);
     ptr->next.reset();
-    ptr->next = nullptr;
 
     updateTail(ptr);
     m_length--;
@@ -77,10 +273,19 @@ class LinkedList {
       return;
     }
 
-    // get the current tail
-    auto ptr = m_head;
+    if (m_finger == m_head.get()) {
+      invalidateFinger();
+    } else if (m_finger) {
+      m_finger_index--;
+    }
+
     auto next_node = m_head->next;
     m_head.reset();
+    if (next_node) {
+      next_node->prev = nullptr;
+    } else {
+      m_tail.reset();
+    }
 
     updateHead(next_node);
     m_length--;
@@ -91,22 +296,30 @@ class LinkedList {
   insert (2,10) // insert to index 2
   {0 1 10 3 4}
   */
-  void insert(size_t index, int value) {
+  void insert(size_t index, const T& value) { emplace(index, value); }
+  void insert(size_t index, T&& value) { emplace(index, std::move(value)); }
+
+  // Construct the element in place before index, returns the new node.
+  template <class... Args>
+  NodeSharedPtr emplace(size_t index, Args&&... args) {
     if (index == 0) {
-      push_front(value);
-      return;
-    } else if (index > m_length - 1) {  // just add at the end.
-      push_back(value);
-      return;
+      emplace_front(std::forward<Args>(args)...);
+      return m_head;
+    } else if (index >= m_length) {  // just add at the end.
+      emplace_back(std::forward<Args>(args)...);
+      return m_tail;
     }
 
     NodeSharedPtr prev_node = node_at(index - 1);
     NodeSharedPtr next_node = prev_node->next;
-    auto new_node = createNode(value);
+    auto new_node = createNode(std::forward<Args>(args)...);
 
-    prev_node->next = new_node;
+    new_node->prev = prev_node.get();
     new_node->next = next_node;
+    next_node->prev = new_node.get();
+    prev_node->next = new_node;
     m_length++;
+    return new_node;
   }
 
   void erase(size_t index) {
@@ -115,90 +328,694 @@ class LinkedList {
     else if (index <= 0)
       return pop_front();
 
-    auto prev_node = node_at(index - 1);
-    deleteNodeViaPrevNode(prev_node);
+    erase(node_at(index));
+  }
+
+  // O(1), the node is already known, e.g. from head()/tail() or node_at().
+  void erase(NodeSharedPtr node) {
+    if (node == m_head) return pop_front();
+    if (node == m_tail) return pop_back();
+
+    deleteNodeViaPrevNode(node->prev);
+  }
+
+  // O(1), returns the iterator following the erased element.
+  iterator erase(const_iterator pos) {
+    ListNode<T>* next = pos.node()->next.get();
+    erase(sharedNode(pos.node()));
+    return iterator(next, &m_tail);
   }
 
   template <class _Pr1>
   void remove_if(_Pr1 eval) {
-    while (eval(m_head->value)) {
-      pop_front();
-    }
-
     auto current_node = m_head;
-    auto prev_node = m_head;
     while (current_node != nullptr) {
+      auto next_node = current_node->next;
       if (eval(current_node->value)) {
-        m_tail = prev_node;
-        deleteNodeViaPrevNode(prev_node);
+        erase(current_node);
       }
-      prev_node = current_node;
-      current_node = current_node->next;
+      current_node = next_node;
     }
   };
 
-  void remove(int val) {
-    remove_if([val](int value) { return value == val; });
+  void remove(const T& val) {
+    remove_if([&val](const T& value) { return value == val; });
+  }
+
+  /*
+  Parallel bulk operations. The list is walked once to cut it into one segment
+  per thread (threads == 0 means hardware_concurrency), each segment is handled
+  by its own std::thread and the results are stitched together in order.
+  The callables must not throw, and must not touch the list itself.
+  */
+  template <class Function>
+  void parallel_for_each(Function f, size_t threads = 0) {
+    auto starts = segmentStarts(threads);
+    runSegments(starts.size() - 1, [&](size_t i) {
+      for (auto node = starts[i]; node != starts[i + 1];
+           node = node->next.get())
+        f(node->value);
+    });
+  }
+
+  // op must be associative, like for std::reduce; init is applied once.
+  template <class U, class BinaryOp>
+  U parallel_reduce(U init, BinaryOp op, size_t threads = 0) {
+    if (m_length == 0) return init;
+
+    auto starts = segmentStarts(threads);
+    std::vector<U> partials(starts.size() - 1, init);
+    runSegments(partials.size(), [&](size_t i) {
+      U acc = starts[i]->value;
+      for (auto node = starts[i]->next.get(); node != starts[i + 1];
+           node = node->next.get())
+        acc = op(std::move(acc), node->value);
+      partials[i] = std::move(acc);
+    });
+    for (auto& partial : partials) init = op(std::move(init), partial);
+    return init;
+  }
+
+  /*
+  Every segment is detached and filtered on its own thread: kept nodes are
+  relinked in one pass, removed ones are chained up and released afterwards on
+  the calling thread, as the NodePool is not thread safe.
+  */
+  template <class _Pr1>
+  void parallel_remove_if(_Pr1 eval, size_t threads = 0) {
+    if (m_length == 0) return;
+
+    auto starts = segmentStarts(threads);
+    size_t parts = starts.size() - 1;
+    std::vector<Segment> segments(parts);
+    segments[0].head = std::move(m_head);
+    for (size_t i = 1; i < parts; i++)
+      segments[i].head = std::move(starts[i]->prev->next);
+    m_tail.reset();
+
+    runSegments(parts, [&](size_t i) { filterSegment(segments[i], eval); });
+
+    // Stitch the kept chains and drop the removed nodes.
+    invalidateFinger();
+    m_length = 0;
+    NodeSharedPtr* link = &m_head;
+    const NodeSharedPtr* last_owner = nullptr;
+    for (auto& segment : segments) {
+      while (segment.removed)
+        segment.removed = std::move(segment.removed->next);
+      if (!segment.head) continue;
+
+      *link = std::move(segment.head);
+      (*link)->prev = last_owner ? last_owner->get() : nullptr;
+      last_owner = segment.last_owner ? segment.last_owner : link;
+      link = &(*last_owner)->next;
+      m_length += segment.kept;
+    }
+    m_tail = last_owner ? *last_owner : nullptr;
+  }
+
+  /*
+  Bottom-up merge sort, stable, O(n log n).
+  Nodes are only relinked, nothing is allocated. bins[i] holds a sorted run of
+  2^i nodes, like the digits of a binary counter.
+  If comp throws, every node is linked back in some order and the list stays
+  valid, like std::list::sort.
+  */
+  void sort() { sort(std::less<T>()); }
+  template <class Compare>
+  void sort(Compare comp) {
+    if (m_length < 2) return;
+
+    NodeSharedPtr bins[64];
+    size_t fill = 0;
+    NodeSharedPtr rest = std::move(m_head);
+    NodeSharedPtr carry;
+    NodeSharedPtr result;
+    m_tail.reset();
+    try {
+      while (rest) {
+        carry = std::move(rest);
+        rest = std::move(carry->next);
+
+        size_t i = 0;
+        for (; i < fill && bins[i]; i++) {
+          // bins[i] holds the earlier elements, it goes first for stability.
+          carry = mergeChains(bins[i], carry, comp);
+        }
+        bins[i] = std::move(carry);
+        if (i == fill) fill++;
+      }
+
+      for (size_t i = 0; i < fill; i++) {
+        result = mergeChains(bins[i], result, comp);
+      }
+    } catch (...) {
+      m_head = std::move(result);
+      appendChain(m_head, std::move(carry));
+      for (size_t i = 0; i < fill; i++) appendChain(m_head, std::move(bins[i]));
+      appendChain(m_head, std::move(rest));
+      relinkPrevAndTail();
+      throw;
+    }
+    m_head = std::move(result);
+    relinkPrevAndTail();
+  }
+
+  // Merge the sorted other into this sorted list, other becomes empty. O(n+m)
+  // If comp throws, this list holds the nodes of both, in some order.
+  void merge(BasicLinkedList& other) { merge(other, std::less<T>()); }
+  template <class Compare>
+  void merge(BasicLinkedList& other, Compare comp) {
+    if (&other == this || other.empty()) return;
+
+    adoptPools(other);
+    m_length += other.m_length;
+    other.m_tail.reset();
+    other.m_length = 0;
+    other.invalidateFinger();
+    try {
+      m_head = mergeChains(m_head, other.m_head, comp);
+    } catch (...) {
+      relinkPrevAndTail();
+      throw;
+    }
+    relinkPrevAndTail();
+  }
+
+  /*
+  Transfer nodes of other before pos, nothing is copied or allocated.
+  (1) entire list: O(1)
+  (2) single element: O(1)
+  (3) range [first, last): linear in the size of the range
+  */
+  void splice(const_iterator pos, BasicLinkedList& other) {
+    if (&other == this || other.empty()) return;
+
+    adoptPools(other);
+    NodeSharedPtr first = std::move(other.m_head);
+    NodeSharedPtr back = std::move(other.m_tail);
+    size_t count = other.m_length;
+    other.m_length = 0;
+    other.invalidateFinger();
+    linkRange(pos, first, back, count);
+  }
+  void splice(const_iterator pos, BasicLinkedList& other, const_iterator it) {
+    splice(pos, other, it, std::next(it));
+  }
+  void splice(const_iterator pos, BasicLinkedList& other,
+              const_iterator first, const_iterator last) {
+    if (first == last) return;
+    // Moving a range of this list in front of itself or of last: no-op.
+    if (&other == this && (pos == first || pos == last)) return;
+
+    size_t count = 0;
+    ListNode<T>* back = nullptr;
+    for (auto it = first; it != last; ++it) {
+      back = it.node();
+      count++;
+    }
+    if (&other != this) adoptPools(other);
+    NodeSharedPtr range_first = other.sharedNode(first.node());
+    NodeSharedPtr range_back = other.sharedNode(back);
+    other.unlinkRange(range_first, range_back, count);
+    linkRange(pos, range_first, range_back, count);
+  }
+
+  // Remove consecutive duplicates, the list is usually sorted beforehand.
+  void unique() { unique(std::equal_to<T>()); }
+  template <class BinaryPredicate>
+  void unique(BinaryPredicate pred) {
+    if (!m_head) return;
+
+    ListNode<T>* prev_node = m_head.get();
+    while (prev_node->next) {
+      if (!pred(prev_node->value, prev_node->next->value)) {
+        prev_node = prev_node->next.get();
+      } else if (prev_node->next == m_tail) {
+        pop_back();
+      } else {
+        deleteNodeViaPrevNode(prev_node);
+      }
+    }
   }
 
   void reverse() {
     // [10, 12, 0, 4] => [4, 0, 12, 10] watch the video. It is quite
     // complicated.s https:// www.geeksforgeeks.org/reverse-a-linked-list/
-    if (!m_head->next) return;
+    // With prev links it is enough to swap next and prev of every node.
+    if (!m_head || !m_head->next) return;
 
+    invalidateFinger();
     m_tail = m_head;
 
-    auto first = m_head;        // first = {10, &12}
-    auto second = first->next;  // second = {12, &0}
-
-    while (second) {
-      auto temp = second->next;  // temp = {0, }		,
-      second->next = first;      // second = {12, &10}
-      first = second;            // first = {12, &10}
-      second = temp;             // second = {0, }
+    NodeSharedPtr reversed;  // head of the already reversed part
+    auto current = m_head;   // current = {10, next &12, prev null}
+    while (current) {
+      auto next = std::move(current->next);  // keep {12, ...} alive
+      current->next = std::move(reversed);   // current = {10, next null}
+      current->prev = next.get();            // current = {10, prev &12}
+      reversed = std::move(current);
+      current = std::move(next);
     }
-    m_head->next = nullptr;
-    m_head = first;
+    m_head = std::move(reversed);
   }
 
-  NodeSharedPtr begin() { return m_head; }
-  NodeSharedPtr end() { return m_tail; }
-  NodeSharedPtr node_at(size_t index) {
-    auto ptr = head();
-    int i = 0;
-    while (ptr != nullptr && i < index) {
-      ptr = ptr->next;
-      i++;
-    }
-    return ptr;
+  iterator begin() { return iterator(m_head.get(), &m_tail); }
+  iterator end() { return iterator(nullptr, &m_tail); }
+  const_iterator begin() const {
+    return const_iterator(m_head.get(), &m_tail);
+  }
+  const_iterator end() const { return const_iterator(nullptr, &m_tail); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
   }
-  int at(size_t index) { return node_at(index)->value; }
-  bool empty() { return m_length == 0; }
-  friend void print(LinkedList list);
-  friend NodeSharedPtr next(LinkedList& list, size_t index = 0);
 
- private:
+  // Node access, first and last node or nullptr.
   NodeSharedPtr head() { return m_head; }
   NodeSharedPtr head() const {
     return m_head;
   }  // for const object, which can not modify the head
+  NodeSharedPtr tail() const { return m_tail; }
+
+  NodeSharedPtr node_at(size_t index) {
+    ListNode<T>* node = nodeAt(index);
+    return node ? sharedNode(node) : nullptr;
+  }
+  T& at(size_t index) { return nodeAt(index)->value; }
+  T& front() { return m_head->value; }
+  T& back() { return m_tail->value; }
+  bool empty() const { return m_length == 0; }
   size_t size() const { return m_length; }
-  // bool operator==(const LinkedList& rhs) const { return true; }
+  const allocator_type& get_allocator() const { return m_allocator; }
+
+  /*
+  Binary format, for trivially copyable T only (load also needs a default
+  constructible T, the values are read into a buffer of T):
+  "LLB1" | uint32 sizeof(T) | uint64 count | count raw values
+  Native byte order, the file is meant to be read back on the same platform.
+  */
+  void save(std::ostream& out) const {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "save needs a trivially copyable T");
+    BinaryHeader header{{'L', 'L', 'B', '1'}, sizeof(T), m_length};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Stream through a small buffer, one write per block of values.
+    std::vector<char> buffer(kBinaryBlock * sizeof(T));
+    size_t used = 0;
+    for (auto node = m_head.get(); node; node = node->next.get()) {
+      std::memcpy(buffer.data() + used, &node->value, sizeof(T));
+      used += sizeof(T);
+      if (used == buffer.size()) {
+        out.write(buffer.data(), used);
+        used = 0;
+      }
+    }
+    out.write(buffer.data(), used);
+  }
+
+  // Throws std::runtime_error on a bad header or a truncated stream.
+  static BasicLinkedList load(std::istream& in) {
+    static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_default_constructible<T>::value,
+                  "load needs a trivially copyable, default constructible T");
+    BinaryHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+      throw std::runtime_error("LinkedList::load: truncated header");
+    checkHeader(header);
+
+    BasicLinkedList list;
+    std::vector<T> buffer(kBinaryBlock);
+    for (uint64_t left = header.count; left > 0;) {
+      size_t count = static_cast<size_t>(
+          left < kBinaryBlock ? left : static_cast<uint64_t>(kBinaryBlock));
+      if (!in.read(reinterpret_cast<char*>(buffer.data()), count * sizeof(T)))
+        throw std::runtime_error("LinkedList::load: truncated values");
+      list.insert(list.cend(), buffer.data(), buffer.data() + count);
+      left -= count;
+      // The count in the header is not checked yet, never reserve more than
+      // was read so far: the pool grows geometrically with the real data.
+      list.reserveNodes(static_cast<size_t>(
+          std::min<uint64_t>(left, list.size())));
+    }
+    return list;
+  }
+
+  // Same format from memory, e.g. a memory mapped file. No copy of the input.
+  static BasicLinkedList load(const void* data, size_t size) {
+    static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_default_constructible<T>::value,
+                  "load needs a trivially copyable, default constructible T");
+    BinaryHeader header;
+    if (size < sizeof(header))
+      throw std::runtime_error("LinkedList::load: truncated header");
+    std::memcpy(&header, data, sizeof(header));
+    checkHeader(header);
+    if ((size - sizeof(header)) / sizeof(T) < header.count)
+      throw std::runtime_error("LinkedList::load: truncated values");
+
+    // The values may be unaligned, copy them out block by block.
+    BasicLinkedList list;
+    std::vector<T> buffer(kBinaryBlock);
+    auto bytes = static_cast<const char*>(data) + sizeof(header);
+    for (uint64_t left = header.count; left > 0;) {
+      size_t count = static_cast<size_t>(
+          left < kBinaryBlock ? left : static_cast<uint64_t>(kBinaryBlock));
+      std::memcpy(buffer.data(), bytes, count * sizeof(T));
+      list.insert(list.cend(), buffer.data(), buffer.data() + count);
+      if (left == header.count) list.reserveNodes(left - count);
+      bytes += count * sizeof(T);
+      left -= count;
+    }
+    return list;
+  }
+
+ private:
+  // bool operator==(const BasicLinkedList& rhs) const { return true; }
 
  private:
-  void add_first_item(int value) {
-    m_head = createNode(value);
+  template <class... Args>
+  void add_first_item(Args&&... args) {
+    m_head = createNode(std::forward<Args>(args)...);
     m_tail = m_head;
     m_length++;
   }
 
-  NodeSharedPtr createNode(int value) { return std::make_shared<Node>(value); }
+  // Nodes and their control blocks come from the list's NodePool.
+  template <class... Args>
+  NodeSharedPtr createNode(Args&&... args) {
+    attachPool(m_allocator);
+    return std::allocate_shared<ListNode<T>>(m_allocator,
+                                             std::forward<Args>(args)...);
+  }
+
+  /*
+  The first node creates the pool of the list. Other allocators are left
+  alone. Spliced or merged nodes go back to the pool they came from, so the
+  pools of the other list are kept alive as well, O(pools) per transfer.
+  */
+  template <class U>
+  void attachPool(PoolAllocator<U>& allocator) {
+    if (allocator.pool()) return;
+    m_pools.push_back(std::make_shared<NodePool>());
+    allocator = PoolAllocator<U>(m_pools.back().get());
+  }
+  template <class OtherAllocator>
+  void attachPool(OtherAllocator&) {}
+  template <class U>
+  static void detachPool(PoolAllocator<U>& allocator) {
+    allocator = PoolAllocator<U>();
+  }
+  template <class OtherAllocator>
+  static void detachPool(OtherAllocator&) {}
+  void adoptPools(const BasicLinkedList& other) {
+    for (auto& pool : other.m_pools) {
+      if (std::find(m_pools.begin(), m_pools.end(), pool) == m_pools.end())
+        m_pools.push_back(pool);
+    }
+  }
+
+  /*
+  Positional lookup with a finger: the last node found by index is cached, and
+  the walk starts from whichever of head, finger or tail is closest.
+  at(0), at(1), at(2)... then costs one step each instead of a walk from head.
+  */
+  ListNode<T>* nodeAt(size_t index) {
+    if (index >= m_length) return nullptr;
+
+    ListNode<T>* node = m_head.get();
+    size_t position = 0;
+    size_t distance = index;
+    if (m_finger) {
+      size_t finger_distance = index > m_finger_index
+                                   ? index - m_finger_index
+                                   : m_finger_index - index;
+      if (finger_distance < distance) {
+        node = m_finger;
+        position = m_finger_index;
+        distance = finger_distance;
+      }
+    }
+    if (m_length - 1 - index < distance) {
+      node = m_tail.get();
+      position = m_length - 1;
+    }
+
+    for (; position < index; position++) node = node->next.get();
+    for (; position > index; position--) node = node->prev;
+
+    m_finger = node;
+    m_finger_index = index;
+    return node;
+  }
+
+  // Any relinking which may move nodes to another index drops the finger.
+  void invalidateFinger() {
+    m_finger = nullptr;
+    m_finger_index = 0;
+  }
+
+  // Owning pointer of a node, it is held either by m_head or by prev->next.
+  NodeSharedPtr sharedNode(ListNode<T>* node) {
+    return node->prev ? node->prev->next : m_head;
+  }
+
+  // Merge two null terminated sorted chains by moving the owning pointers,
+  // a and b are left empty. If comp throws, a holds the nodes of both.
+  template <class Compare>
+  static NodeSharedPtr mergeChains(NodeSharedPtr& a, NodeSharedPtr& b,
+                                   Compare& comp) {
+    NodeSharedPtr merged;
+    NodeSharedPtr* link = &merged;
+    try {
+      while (a && b) {
+        if (comp(b->value, a->value)) {
+          *link = std::move(b);
+          b = std::move((*link)->next);
+        } else {
+          *link = std::move(a);
+          a = std::move((*link)->next);
+        }
+        link = &(*link)->next;
+      }
+    } catch (...) {
+      *link = std::move(a);
+      appendChain(merged, std::move(b));
+      a = std::move(merged);
+      throw;
+    }
+    *link = a ? std::move(a) : std::move(b);
+    return merged;
+  }
+
+  // Hang the chain tail behind the last node of chain, O(length of chain).
+  static void appendChain(NodeSharedPtr& chain, NodeSharedPtr tail) {
+    NodeSharedPtr* link = &chain;
+    while (*link) link = &(*link)->next;
+    *link = std::move(tail);
+  }
+
+  struct BinaryHeader {
+    char magic[4];
+    uint32_t value_size;
+    uint64_t count;
+  };
+  enum : size_t { kBinaryBlock = 4096 };  // values per read/write
+
+  static void checkHeader(const BinaryHeader& header) {
+    if (std::memcmp(header.magic, "LLB1", 4) != 0)
+      throw std::runtime_error("LinkedList::load: not a LinkedList file");
+    if (header.value_size != sizeof(T))
+      throw std::runtime_error("LinkedList::load: value size mismatch");
+  }
+
+  /*
+  Let the pool carve room for node_count more nodes in one go, so a bulk
+  build does not grow it chunk by chunk. The pool's block size is fixed by
+  its first node, so nothing is reserved before a node exists.
+  Other allocators are left alone.
+  */
+  void reserveNodes(size_t node_count) {
+    reserveNodes(m_allocator, node_count);
+  }
+  template <class U>
+  static void reserveNodes(PoolAllocator<U>& allocator, size_t node_count) {
+    if (!allocator.pool() || allocator.pool()->live_blocks() == 0) return;
+    allocator.pool()->reserve(node_count, 1, 1);
+  }
+  template <class OtherAllocator>
+  static void reserveNodes(OtherAllocator&, size_t) {}
+
+  template <class InputIt>
+  static size_t rangeLength(InputIt first, InputIt last,
+                            std::forward_iterator_tag) {
+    return static_cast<size_t>(std::distance(first, last));
+  }
+  template <class InputIt>
+  static size_t rangeLength(InputIt, InputIt, std::input_iterator_tag) {
+    return 0;  // unknown, a single pass range
+  }
+
+  // Build the detached chain [front, back] out of [first, last), returns its
+  // length.
+  template <class InputIt>
+  size_t buildChain(InputIt first, InputIt last, NodeSharedPtr& front,
+                    NodeSharedPtr& back) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if (first == last) return 0;
+
+    size_t length = rangeLength(first, last, category());
+    size_t count = 0;
+    try {
+      front = createNode(*first);
+      count++;
+      if (length > 1) reserveNodes(length - 1);
+      // Walk the owning pointers, the new node is moved into place, so
+      // linking costs no reference count round trip.
+      NodeSharedPtr* owner = &front;
+      for (++first; first != last; ++first) {
+        NodeSharedPtr node = createNode(*first);
+        node->prev = owner->get();
+        (*owner)->next = std::move(node);
+        owner = &(*owner)->next;
+        count++;
+      }
+      back = *owner;
+    } catch (...) {
+      while (front) front = std::move(front->next);
+      throw;
+    }
+    return count;
+  }
+
+  // Detached part of the list in parallel_remove_if.
+  struct Segment {
+    NodeSharedPtr head;
+    NodeSharedPtr* last_owner{nullptr};  // owner of the last kept node,
+                                         // nullptr while it is head
+    NodeSharedPtr removed;               // chained through next
+    size_t kept{0};
+  };
+
+  // First node of each segment, the last entry is the end (nullptr).
+  std::vector<ListNode<T>*> segmentStarts(size_t threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    size_t parts = std::max<size_t>(
+        1, std::min<size_t>(threads, m_length / kMinParallelSegment));
+    std::vector<ListNode<T>*> starts;
+    starts.reserve(parts + 1);
+    ListNode<T>* node = m_head.get();
+    for (size_t i = 0; i < parts; i++) {
+      starts.push_back(node);
+      size_t length = m_length / parts + (i < m_length % parts ? 1 : 0);
+      while (length--) node = node->next.get();
+    }
+    starts.push_back(nullptr);
+    return starts;
+  }
+
+  // Run job(0) ... job(parts - 1), job(0) on the calling thread.
+  template <class Job>
+  static void runSegments(size_t parts, Job job) {
+    std::vector<std::thread> workers;
+    workers.reserve(parts);
+    for (size_t i = 1; i < parts; i++) workers.emplace_back(job, i);
+    job(0);
+    for (auto& worker : workers) worker.join();
+  }
+
+  // Keep the nodes failing eval in order, move the others to removed.
+  template <class _Pr1>
+  static void filterSegment(Segment& segment, _Pr1& eval) {
+    NodeSharedPtr current = std::move(segment.head);
+    NodeSharedPtr* link = &segment.head;
+    NodeSharedPtr* last_owner = nullptr;
+    while (current) {
+      NodeSharedPtr next_node = std::move(current->next);
+      if (eval(current->value)) {
+        current->next = std::move(segment.removed);
+        segment.removed = std::move(current);
+      } else {
+        if (last_owner) current->prev = last_owner->get();
+        *link = std::move(current);
+        last_owner = link;
+        link = &(*link)->next;
+        segment.kept++;
+      }
+      current = std::move(next_node);
+    }
+    segment.last_owner = last_owner == &segment.head ? nullptr : last_owner;
+  }
+
+  // Rebuild prev links and m_tail after the next chain was relinked.
+  void relinkPrevAndTail() {
+    invalidateFinger();
+    const NodeSharedPtr* prev_owner = nullptr;
+    NodeSharedPtr* owner = &m_head;
+    while (*owner) {
+      (*owner)->prev = prev_owner ? prev_owner->get() : nullptr;
+      prev_owner = owner;
+      owner = &(*owner)->next;
+    }
+    m_tail = prev_owner ? *prev_owner : nullptr;
+  }
+
+  // Cut [first, back] out of the list, the caller keeps them alive.
+  void unlinkRange(const NodeSharedPtr& first, const NodeSharedPtr& back,
+                   size_t count) {
+    invalidateFinger();
+    ListNode<T>* before = first->prev;
+    NodeSharedPtr after = back->next;
+    if (before) {
+      before->next = after;
+    } else {
+      m_head = after;
+    }
+    if (after) {
+      after->prev = before;
+    } else {
+      m_tail = before ? sharedNode(before) : nullptr;
+    }
+    first->prev = nullptr;
+    back->next.reset();
+    m_length -= count;
+  }
+
+  // Link the detached chain [first, back] before pos.
+  void linkRange(const_iterator pos, const NodeSharedPtr& first,
+                 const NodeSharedPtr& back, size_t count) {
+    invalidateFinger();
+    NodeSharedPtr after = pos.node() ? sharedNode(pos.node()) : nullptr;
+    ListNode<T>* before = after ? after->prev : m_tail.get();
+    first->prev = before;
+    if (before) {
+      before->next = first;
+    } else {
+      m_head = first;
+    }
+    back->next = after;
+    if (after) {
+      after->prev = back.get();
+    } else {
+      m_tail = back;
+    }
+    m_length += count;
+  }
 
   void updateTail(NodeSharedPtr new_node) { m_tail = new_node; }
   void updateHead(NodeSharedPtr new_node) { m_head = new_node; }
-  void deleteNodeViaPrevNode(NodeSharedPtr prev_node) {
+  void deleteNodeViaPrevNode(ListNode<T>* prev_node) {
+    invalidateFinger();
     auto node_to_delete = prev_node->next;
     prev_node->next = node_to_delete->next;
+    if (prev_node->next) prev_node->next->prev = prev_node;
     node_to_delete.reset();
     m_length--;
   }
@@ -207,11 +1024,20 @@ class LinkedList {
   NodeSharedPtr m_head{nullptr};
   NodeSharedPtr m_tail{nullptr};
   size_t m_length{0};
+  // Pools the nodes come from, ~BasicLinkedList releases the nodes first.
+  std::vector<std::shared_ptr<NodePool>> m_pools;
+  allocator_type m_allocator;
+  ListNode<T>* m_finger{nullptr};  // cached result of the last nodeAt
+  size_t m_finger_index{0};
 };
 
+using LinkedList = BasicLinkedList<int>;
+
 namespace std {
-NodeSharedPtr next(NodeSharedPtr ptr, size_t index = 1) {
-  NodeSharedPtr temp = ptr;
+template <class T>
+inline shared_ptr<ListNode<T>> next(shared_ptr<ListNode<T>> ptr,
+                                    size_t index = 1) {
+  shared_ptr<ListNode<T>> temp = ptr;
   size_t i = 0;
   while (i < index) {
     temp = temp->next;
@@ -220,7 +1046,25 @@ NodeSharedPtr next(NodeSharedPtr ptr, size_t index = 1) {
   return temp;
 };
 
-void print(const LinkedList& list) { return; };
+// prev links are plain pointers, and the owner of the head is the list
+// itself, not reachable from the nodes. So the walk back returns the plain
+// node pointer, valid as long as the list holds the node.
+template <class T>
+inline ListNode<T>* prev(const shared_ptr<ListNode<T>>& ptr,
+                         size_t index = 1) {
+  ListNode<T>* temp = ptr.get();
+  size_t i = 0;
+  while (i < index && temp) {
+    temp = temp->prev;
+    i++;
+  }
+  return temp;
+};
+
+template <class T, class Allocator>
+inline void print(const BasicLinkedList<T, Allocator>& list) {
+  return;
+};
 
 }  // namespace std
 // void static printList(const LinkedList& list, const std::string& title = "")
@@ -1,23 +1,149 @@
 ﻿#pragma once
+#include <atomic>
+#include <cstdint>
 #include <memory>
-struct Node {
-  Node(int val) : value(val) {}
-  Node(int val, std::shared_ptr<Node> nxt) : value(val), next(nxt) {}
+#include <new>
+#include <utility>
+template <class T>
+struct ListNode {
+  // value is constructed in place from args, no temporary T is created.
+  template <class... Args>
+  explicit ListNode(Args&&... args) : value(std::forward<Args>(args)...) {}
 
-  int value{-1};
-  std::shared_ptr<Node> next{nullptr};
+  T value;
+  std::shared_ptr<ListNode> next{nullptr};
+  ListNode* prev{nullptr};  // back link, not owning, next already does
 };
+using Node = ListNode<int>;
 using NodeSharedPtr = std::shared_ptr<Node>;
 
-struct BNode {
-  BNode(int val) : value(val) {}
-  BNode(int val, std::shared_ptr<BNode> left_, std::shared_ptr<BNode> right_)
-      : value(val), left(left_), right(right_) {}
+// Node of a persistent list, never changed once it is reachable from a
+// snapshot. length is the number of nodes from this node to the end.
+template <class T>
+struct PersistentNode {
+  template <class... Args>
+  PersistentNode(std::shared_ptr<PersistentNode> nxt, Args&&... args)
+      : value(std::forward<Args>(args)...),
+        next(std::move(nxt)),
+        length(next ? next->length + 1 : 1) {}
+  PersistentNode(const PersistentNode&) = delete;
+  PersistentNode& operator=(const PersistentNode&) = delete;
+  // Frees the tail nobody else holds one node at a time, the implicit
+  // destructor would recurse once per node. Only this dying node is
+  // written: the next node is copied out before it is let go, so its own
+  // destructor stops at once and a shared node is never touched.
+  ~PersistentNode() {
+    std::shared_ptr<PersistentNode> ptr = std::move(next);
+    while (ptr && ptr.use_count() == 1) {
+      std::shared_ptr<PersistentNode> following = ptr->next;
+      ptr = std::move(following);
+    }
+  }
 
-  int operator->() const { return value; }
+  T value;
+  std::shared_ptr<PersistentNode> next;
+  size_t length;
+};
+
+// Node with unique ownership: next owns, prev is a plain back pointer.
+template <class T>
+struct UniqueNode {
+  template <class... Args>
+  explicit UniqueNode(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+  T value;
+  std::unique_ptr<UniqueNode> next{nullptr};
+  UniqueNode* prev{nullptr};
+};
+
+// Node of the lock-free queue: same value + next layout, the link is atomic.
+template <class T>
+struct QueueNode {
+  template <class... Args>
+  explicit QueueNode(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+  T value;
+  std::atomic<QueueNode*> next{nullptr};
+};
+
+// Node of the concurrent tree's skip list: the key never changes, next[i] is
+// the link on level i, a node is in levels [0, levels). The links are stored
+// right behind the node in the same allocation, use create and destroy.
+template <class Key>
+struct ConcurrentSkipNode {
+  using Link = std::atomic<ConcurrentSkipNode*>;
+
+  static ConcurrentSkipNode* create(const Key& key, size_t levels) {
+    static_assert(alignof(ConcurrentSkipNode) <=
+                      __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "over-aligned keys are not supported");
+    void* memory = ::operator new(sizeof(ConcurrentSkipNode) +
+                                  levels * sizeof(Link));
+    Link* links = reinterpret_cast<Link*>(
+        static_cast<char*>(memory) + sizeof(ConcurrentSkipNode));
+    for (size_t i = 0; i < levels; i++) new (links + i) Link(nullptr);
+    try {
+      return new (memory) ConcurrentSkipNode(key, levels, links);
+    } catch (...) {
+      ::operator delete(memory);
+      throw;
+    }
+  }
+  static void destroy(ConcurrentSkipNode* node) {
+    node->~ConcurrentSkipNode();
+    ::operator delete(node);
+  }
+
+  const Key value;
+  const size_t levels;
+  Link* const next;
+
+ private:
+  ConcurrentSkipNode(const Key& key, size_t level_count, Link* links)
+      : value(key), levels(level_count), next(links) {}
+};
+
+// Node of an arena tree: children are indices into the node vector, 0 is
+// none (index 0 is the root, never a child). 12 bytes for an int key.
+template <class Key>
+struct ArenaTreeNode {
+  Key value;
+  uint32_t left{0};
+  uint32_t right{0};
+};
+
+// Block of an unrolled list, up to Capacity values stored next to each other.
+template <size_t Capacity>
+struct UNode {
+  size_t count{0};
+  int values[Capacity];
+  std::shared_ptr<UNode> next{nullptr};
+  UNode* prev{nullptr};  // back link, not owning
+};
+
+// Mapped type of a tree used as a set.
+struct NoMapped {};
+
+// Node of a binary search tree: value is the key, mapped the payload.
+template <class Key, class Mapped = NoMapped>
+struct TreeNode {
+  TreeNode(Key val) : value(std::move(val)) {}
+  TreeNode(Key val, std::shared_ptr<TreeNode> left_,
+           std::shared_ptr<TreeNode> right_)
+      : value(std::move(val)), left(left_), right(right_) {}
+  template <class K, class... Args>
+  TreeNode(std::piecewise_construct_t, K&& val, Args&&... args)
+      : value(std::forward<K>(val)), mapped(std::forward<Args>(args)...) {}
+
+  Key operator->() const { return value; }
 
-  int value{-1};
-  std::shared_ptr<BNode> left{nullptr};
-  std::shared_ptr<BNode> right{nullptr};
+  Key value;
+  Mapped mapped{};
+  std::shared_ptr<TreeNode> left{nullptr};
+  std::shared_ptr<TreeNode> right{nullptr};
+  TreeNode* parent{nullptr};  // back link for iteration, not owning
+  int height{1};  // of the subtree, kept up to date by balancing trees
+  size_t size{1};  // nodes in the subtree, for rank and select
 };
+using BNode = TreeNode<int>;
 using BNodeSharedPtr = std::shared_ptr<BNode>;
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+/*
+Slab storage for list nodes.
+Nodes are carved out of big chunks instead of one heap allocation per node.
+A released node goes to the free list and is handed out by the next allocate.
+All chunks go back to the heap together when the pool dies, O(chunks).
+The first request also fixes the block alignment, chunks are allocated with
+it, so over-aligned nodes are pooled as well.
+
+Not thread safe, one pool belongs to one container.
+*/
+class NodePool {
+ public:
+  explicit NodePool(size_t nodes_per_chunk = 1024)
+      : m_nodes_per_chunk(nodes_per_chunk ? nodes_per_chunk : 1) {}
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  void* allocate(size_t size, size_t alignment) {
+    // The first request fixes the block size of the pool.
+    if (m_block_size == 0) setBlockSize(size, alignment);
+    if (!fits(size, alignment)) {
+      m_heap_allocations++;
+      return ::operator new(size, std::align_val_t(alignment));
+    }
+
+    if (!m_free_list) addChunk(m_nodes_per_chunk);
+    FreeBlock* block = m_free_list;
+    m_free_list = block->next;
+    m_live_blocks++;
+    m_free_blocks--;
+    return block;
+  }
+
+  void deallocate(void* ptr, size_t size, size_t alignment) {
+    if (!fits(size, alignment)) {
+      ::operator delete(ptr, std::align_val_t(alignment));
+      return;
+    }
+
+    auto block = static_cast<FreeBlock*>(ptr);
+    block->next = m_free_list;
+    m_free_list = block;
+    m_live_blocks--;
+    m_free_blocks++;
+  }
+
+  // Pre-allocate one chunk big enough to hand out node_count more blocks
+  // without growing. Throws std::length_error if the chunk size overflows.
+  void reserve(size_t node_count, size_t size, size_t alignment) {
+    if (m_block_size == 0) setBlockSize(size, alignment);
+    if (!fits(size, alignment)) return;
+    if (m_free_blocks < node_count) addChunk(node_count - m_free_blocks);
+  }
+
+  size_t chunk_count() const { return m_chunks.size(); }
+  size_t live_blocks() const { return m_live_blocks; }
+  // Number of times the pool itself went to the heap (chunks + fallbacks).
+  size_t heap_allocations() const { return m_heap_allocations; }
+
+ private:
+  union FreeBlock {
+    FreeBlock* next;
+    std::max_align_t align;
+  };
+
+  // Blocks are laid out back to back in chunks aligned like a block, so the
+  // size is a multiple of the alignment (at least that of FreeBlock).
+  void setBlockSize(size_t size, size_t alignment) {
+    size_t block = size < sizeof(FreeBlock) ? sizeof(FreeBlock) : size;
+    m_block_alignment =
+        alignment > alignof(FreeBlock) ? alignment : alignof(FreeBlock);
+    m_block_size =
+        (block + m_block_alignment - 1) / m_block_alignment * m_block_alignment;
+  }
+
+  bool fits(size_t size, size_t alignment) const {
+    return size <= m_block_size && alignment <= m_block_alignment;
+  }
+
+  struct ChunkDeleter {
+    size_t alignment;
+    void operator()(char* chunk) const {
+      ::operator delete(chunk, std::align_val_t(alignment));
+    }
+  };
+
+  void addChunk(size_t block_count) {
+    if (block_count > std::numeric_limits<size_t>::max() / m_block_size)
+      throw std::length_error("NodePool: chunk size overflows");
+    m_chunks.emplace_back(
+        static_cast<char*>(::operator new(m_block_size * block_count,
+                                          std::align_val_t(m_block_alignment))),
+        ChunkDeleter{m_block_alignment});
+    m_heap_allocations++;
+    m_free_blocks += block_count;
+
+    // thread the new blocks into the free list, first block on top.
+    char* begin = m_chunks.back().get();
+    for (size_t i = block_count; i-- > 0;) {
+      auto block = reinterpret_cast<FreeBlock*>(begin + i * m_block_size);
+      block->next = m_free_list;
+      m_free_list = block;
+    }
+  }
+
+  size_t m_nodes_per_chunk;
+  size_t m_block_size{0};
+  size_t m_block_alignment{alignof(FreeBlock)};
+  size_t m_live_blocks{0};
+  size_t m_free_blocks{0};
+  size_t m_heap_allocations{0};
+  FreeBlock* m_free_list{nullptr};
+  std::vector<std::unique_ptr<char, ChunkDeleter>> m_chunks;
+};
+
+/*
+Standard allocator front end of NodePool.
+It only points to the pool, copies and rebound copies point to the same one,
+so std::allocate_shared stores a plain pointer with every node and creating
+or freeing a node touches no reference count. The owner of the pool (the
+container) must keep it alive until the last node allocated from it is gone.
+A default constructed allocator has no pool yet.
+*/
+template <class T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  explicit PoolAllocator(NodePool* pool) : m_pool(pool) {}
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>& other) : m_pool(other.pool()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(m_pool->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* ptr, size_t n) {
+    m_pool->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  NodePool* pool() const { return m_pool; }
+
+  // A copied container gets a pool of its own.
+  PoolAllocator select_on_container_copy_construction() const {
+    return PoolAllocator();
+  }
+
+  template <class U>
+  bool operator==(const PoolAllocator<U>& rhs) const {
+    return m_pool == rhs.pool();
+  }
+  template <class U>
+  bool operator!=(const PoolAllocator<U>& rhs) const {
+    return m_pool != rhs.pool();
+  }
+
+ private:
+  NodePool* m_pool{nullptr};
+};
@@ -0,0 +1,214 @@
+﻿#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Node.h"
+
+/*
+Persistent (copy-on-write) singly linked list for one writer and many readers.
+Nodes are never modified once published. A write copies only the prefix in
+front of the changed position and shares the rest:
+
+before:   head -> {1} -> {2} -> {3} -> {4}
+insert(2, 9):
+new head -> {1'} -> {2'} -> {9} ---^ {3} -> {4} shared with the old version
+
+snapshot() is O(1): it grabs the current head, and the readers walk it
+without any lock while the writer keeps going. The head is published with
+the atomic shared_ptr functions. An old version dies with its last holder,
+~PersistentNode frees its unshared nodes iteratively, whether that is a
+snapshot, an assignment or a write that replaced a long prefix.
+*/
+template <class T>
+class PersistentLinkedList {
+ public:
+  using Node = PersistentNode<T>;
+  using NodeSharedPtr = std::shared_ptr<Node>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+    explicit const_iterator(const Node* node) : m_node(node) {}
+
+    reference operator*() const { return m_node->value; }
+    pointer operator->() const { return &m_node->value; }
+    const_iterator& operator++() {
+      m_node = m_node->next.get();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return m_node == rhs.m_node;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return m_node != rhs.m_node;
+    }
+
+   private:
+    const Node* m_node{nullptr};
+  };
+  using iterator = const_iterator;
+  using value_type = T;
+
+  // Immutable view of one version of the list.
+  class Snapshot {
+   public:
+    using const_iterator = PersistentLinkedList::const_iterator;
+    using iterator = const_iterator;
+    using value_type = T;
+
+    Snapshot() = default;
+    explicit Snapshot(NodeSharedPtr head) : m_head(std::move(head)) {}
+    Snapshot(const Snapshot&) = default;
+    // Copy and swap, the old version is released by the temporary.
+    Snapshot& operator=(Snapshot other) noexcept {
+      swap(other);
+      return *this;
+    }
+    void swap(Snapshot& other) noexcept { m_head.swap(other.m_head); }
+
+    const T& at(size_t index) const {
+      const Node* node = m_head.get();
+      while (index--) node = node->next.get();
+      return node->value;
+    }
+    size_t size() const { return m_head ? m_head->length : 0; }
+    bool empty() const { return !m_head; }
+    const_iterator begin() const { return const_iterator(m_head.get()); }
+    const_iterator end() const { return const_iterator(); }
+
+   private:
+    NodeSharedPtr m_head;
+  };
+
+  PersistentLinkedList() {}
+  PersistentLinkedList(std::initializer_list<T> v)
+      : PersistentLinkedList(v.begin(), v.end()) {}
+  // O(n), the nodes are built back to front. The way to fill a list in order,
+  // push_back would copy the whole list every time.
+  template <class InputIt,
+            class = typename std::enable_if<std::is_convertible<
+                typename std::iterator_traits<InputIt>::iterator_category,
+                std::input_iterator_tag>::value>::type>
+  PersistentLinkedList(InputIt first, InputIt last) {
+    std::vector<T> values(first, last);
+    NodeSharedPtr head;
+    for (auto it = values.rbegin(); it != values.rend(); ++it) {
+      head = std::make_shared<Node>(std::move(head), std::move(*it));
+    }
+    publish(std::move(head));
+  }
+  PersistentLinkedList(const PersistentLinkedList&) = delete;
+  PersistentLinkedList& operator=(const PersistentLinkedList&) = delete;
+
+  // O(1), shares the whole current version.
+  Snapshot snapshot() const { return Snapshot(load()); }
+
+  // Writer side, only one thread may write at a time.
+
+  void push_front(const T& value) {
+    publish(std::make_shared<Node>(load(), value));
+  }
+
+  // Copies every node, O(n): n push_backs cost O(n^2). Build a list in
+  // order with the range constructor, or with push_front from the back.
+  void push_back(const T& value) { insert(size(), value); }
+
+  void pop_front() {
+    NodeSharedPtr head = load();
+    if (head) publish(head->next);
+  }
+
+  /*
+  {0 1 3 4}
+  insert (2,10) // insert to index 2, {0 1} are copied, {3 4} are shared
+  {0 1 10 3 4}
+  */
+  void insert(size_t index, const T& value) {
+    NodeSharedPtr head = load();
+    std::vector<const Node*> prefix;
+    const Node* node = head.get();
+    for (size_t i = 0; i < index && node; i++) {
+      prefix.push_back(node);
+      node = node->next.get();
+    }
+    NodeSharedPtr suffix = prefix.empty() ? head : prefix.back()->next;
+    publish(copyPrefix(prefix, std::make_shared<Node>(suffix, value)));
+  }
+
+  void erase(size_t index) {
+    NodeSharedPtr head = load();
+    std::vector<const Node*> prefix;
+    const Node* node = head.get();
+    for (size_t i = 0; i < index && node; i++) {
+      prefix.push_back(node);
+      node = node->next.get();
+    }
+    if (!node) return;
+    publish(copyPrefix(prefix, node->next));
+  }
+
+  // Copies the nodes up to the last removed one, the rest is shared.
+  template <class _Pr1>
+  void remove_if(_Pr1 eval) {
+    NodeSharedPtr head = load();
+    std::vector<const Node*> kept;
+    const Node* last_removed = nullptr;
+    size_t kept_before_last_removed = 0;
+    for (const Node* node = head.get(); node; node = node->next.get()) {
+      if (eval(node->value)) {
+        last_removed = node;
+        kept_before_last_removed = kept.size();
+      } else {
+        kept.push_back(node);
+      }
+    }
+    if (!last_removed) return;
+
+    kept.resize(kept_before_last_removed);
+    publish(copyPrefix(kept, last_removed->next));
+  }
+
+  void remove(const T& val) {
+    remove_if([&val](const T& value) { return value == val; });
+  }
+
+  // A copy: the node may be dropped by a writer as soon as the temporary
+  // snapshot is gone. Hold a Snapshot to read by reference.
+  T at(size_t index) const { return snapshot().at(index); }
+  size_t size() const {
+    NodeSharedPtr head = load();
+    return head ? head->length : 0;
+  }
+  bool empty() const { return size() == 0; }
+
+ private:
+  NodeSharedPtr load() const { return std::atomic_load(&m_head); }
+  void publish(NodeSharedPtr head) { std::atomic_store(&m_head, head); }
+
+  // Copy the values of nodes in front of suffix, back to front.
+  static NodeSharedPtr copyPrefix(const std::vector<const Node*>& nodes,
+                                  NodeSharedPtr suffix) {
+    for (auto it = nodes.rbegin(); it != nodes.rend(); it++) {
+      suffix = std::make_shared<Node>(std::move(suffix), (*it)->value);
+    }
+    return suffix;
+  }
+
+ private:
+  NodeSharedPtr m_head;
+};
@@ -0,0 +1,218 @@
+﻿#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "Node.h"
+
+/*
+Doubly linked list with unique ownership of the nodes.
+Every node is owned by the next pointer of its predecessor (or m_head), prev
+and m_tail are plain pointers. Walking the list copies no shared_ptr, so there
+is no refcount traffic, and the destructor unlinks iteratively so lists of
+any length can be destroyed without deep recursion.
+*/
+template <class T>
+class UniqueLinkedList {
+ public:
+  using Node = UniqueNode<T>;
+
+  template <bool Const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::conditional<Const, const T*, T*>::type;
+    using reference = typename std::conditional<Const, const T&, T&>::type;
+
+    Iterator() = default;
+    explicit Iterator(Node* node) : m_node(node) {}
+
+    reference operator*() const { return m_node->value; }
+    pointer operator->() const { return &m_node->value; }
+    Iterator& operator++() {
+      m_node = m_node->next.get();
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const Iterator& rhs) const { return m_node == rhs.m_node; }
+    bool operator!=(const Iterator& rhs) const { return m_node != rhs.m_node; }
+
+   private:
+    Node* m_node{nullptr};
+  };
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using value_type = T;
+
+  UniqueLinkedList() {}
+  UniqueLinkedList(std::initializer_list<T> v) {
+    for (auto it = v.begin(); it != v.end(); it++) {
+      push_back(*it);
+    }
+  }
+  UniqueLinkedList(const UniqueLinkedList&) = delete;
+  UniqueLinkedList& operator=(const UniqueLinkedList&) = delete;
+  UniqueLinkedList(UniqueLinkedList&& rhs) { *this = std::move(rhs); }
+  UniqueLinkedList& operator=(UniqueLinkedList&& rhs) {
+    if (this != &rhs) {
+      clear();
+      m_head = std::move(rhs.m_head);
+      m_tail = rhs.m_tail;
+      m_length = rhs.m_length;
+      rhs.m_tail = nullptr;
+      rhs.m_length = 0;
+    }
+    return *this;
+  }
+  ~UniqueLinkedList() { clear(); }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  template <class... Args>
+  void emplace_back(Args&&... args) {
+    std::unique_ptr<Node> node(new Node(std::forward<Args>(args)...));
+    node->prev = m_tail;
+    Node* raw = node.get();
+    if (m_tail) {
+      m_tail->next = std::move(node);
+    } else {
+      m_head = std::move(node);
+    }
+    m_tail = raw;
+    m_length++;
+  }
+
+  template <class... Args>
+  void emplace_front(Args&&... args) {
+    std::unique_ptr<Node> node(new Node(std::forward<Args>(args)...));
+    if (m_head) {
+      m_head->prev = node.get();
+    } else {
+      m_tail = node.get();
+    }
+    node->next = std::move(m_head);
+    m_head = std::move(node);
+    m_length++;
+  }
+
+  void pop_back() {
+    if (empty()) return;
+    unlink(m_tail);
+  }
+
+  void pop_front() {
+    if (empty()) return;
+    unlink(m_head.get());
+  }
+
+  /*
+  {0 1 3 4}
+  insert (2,10) // insert to index 2
+  {0 1 10 3 4}
+  */
+  void insert(size_t index, const T& value) {
+    if (index == 0) return push_front(value);
+    if (index >= m_length) return push_back(value);
+
+    Node* prev_node = nodeAt(index - 1);
+    std::unique_ptr<Node> node(new Node(value));
+    node->prev = prev_node;
+    node->next = std::move(prev_node->next);
+    node->next->prev = node.get();
+    prev_node->next = std::move(node);
+    m_length++;
+  }
+
+  void erase(size_t index) {
+    if (index < m_length) unlink(nodeAt(index));
+  }
+
+  template <class _Pr1>
+  void remove_if(_Pr1 eval) {
+    Node* node = m_head.get();
+    while (node) {
+      Node* next = node->next.get();
+      if (eval(node->value)) unlink(node);
+      node = next;
+    }
+  }
+
+  void remove(const T& val) {
+    remove_if([&val](const T& value) { return value == val; });
+  }
+
+  void reverse() {
+    // detach the nodes from the front and push them to the new front.
+    std::unique_ptr<Node> reversed;
+    m_tail = m_head.get();
+    while (m_head) {
+      std::unique_ptr<Node> node = std::move(m_head);
+      m_head = std::move(node->next);
+      if (m_head) m_head->prev = nullptr;
+      if (reversed) reversed->prev = node.get();
+      node->next = std::move(reversed);
+      reversed = std::move(node);
+    }
+    m_head = std::move(reversed);
+  }
+
+  void clear() {
+    // one node at a time, ~UniqueNode would recurse through next.
+    while (m_head) {
+      m_head = std::move(m_head->next);
+    }
+    m_tail = nullptr;
+    m_length = 0;
+  }
+
+  T& at(size_t index) { return nodeAt(index)->value; }
+  T& front() { return m_head->value; }
+  T& back() { return m_tail->value; }
+  size_t size() const { return m_length; }
+  bool empty() const { return m_length == 0; }
+
+  iterator begin() { return iterator(m_head.get()); }
+  iterator end() { return iterator(); }
+  const_iterator begin() const { return const_iterator(m_head.get()); }
+  const_iterator end() const { return const_iterator(); }
+
+ private:
+  Node* nodeAt(size_t index) const {
+    // walk from the closer end
+    if (index < m_length / 2) {
+      Node* node = m_head.get();
+      while (index--) node = node->next.get();
+      return node;
+    }
+    Node* node = m_tail;
+    for (size_t i = m_length - 1; i > index; i--) node = node->prev;
+    return node;
+  }
+
+  void unlink(Node* node) {
+    Node* prev_node = node->prev;
+    std::unique_ptr<Node>& owner = prev_node ? prev_node->next : m_head;
+    if (node->next) {
+      node->next->prev = prev_node;
+    } else {
+      m_tail = prev_node;
+    }
+    owner = std::move(node->next);  // destroys node
+    m_length--;
+  }
+
+ private:
+  std::unique_ptr<Node> m_head{nullptr};
+  Node* m_tail{nullptr};  // owned by the chain starting at m_head
+  size_t m_length{0};
+};
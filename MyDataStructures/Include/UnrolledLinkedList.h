@@ -0,0 +1,287 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include "Node.h"
+
+/*
+Unrolled linked list: same API as LinkedList, but every node is a block of
+kBlockCapacity values. Traversal and filtering walk contiguous arrays and only
+follow a pointer once per block. Blocks are doubly linked, so emptying the
+tail block in pop_back is O(1).
+
+{1 2 3 4} {5 6} {7 8 9}
+*/
+class UnrolledLinkedList {
+ public:
+  enum : size_t { kBlockCapacity = 64 };
+  using Block = UNode<kBlockCapacity>;
+  using BlockSharedPtr = std::shared_ptr<Block>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const int*;
+    using reference = const int&;
+
+    const_iterator() = default;
+    const_iterator(const Block* block, size_t offset)
+        : m_block(block), m_offset(offset) {}
+
+    reference operator*() const { return m_block->values[m_offset]; }
+    pointer operator->() const { return &m_block->values[m_offset]; }
+    const_iterator& operator++() {
+      if (++m_offset == m_block->count) {
+        m_block = m_block->next.get();
+        m_offset = 0;
+      }
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto temp = *this;
+      ++*this;
+      return temp;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return m_block == rhs.m_block && m_offset == rhs.m_offset;
+    }
+    bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+   private:
+    const Block* m_block{nullptr};
+    size_t m_offset{0};
+  };
+  using iterator = const_iterator;
+  using value_type = int;
+
+  UnrolledLinkedList() {}
+  UnrolledLinkedList(std::initializer_list<int> v) {
+    for (auto it = v.begin(); it != v.end(); it++) {
+      push_back(*it);
+    }
+  }
+  UnrolledLinkedList(const UnrolledLinkedList&) = delete;
+  UnrolledLinkedList& operator=(const UnrolledLinkedList&) = delete;
+  ~UnrolledLinkedList() { clear(); }
+
+  void push_back(int value) {
+    if (!m_tail || m_tail->count == kBlockCapacity) {
+      auto block = createBlock();
+      block->prev = m_tail;
+      if (m_tail) {
+        m_tail->next = block;
+      } else {
+        m_head = block;
+      }
+      m_tail = block.get();
+    }
+    m_tail->values[m_tail->count++] = value;
+    m_length++;
+  }
+
+  void push_front(int value) {
+    if (!m_head || m_head->count == kBlockCapacity) {
+      auto block = createBlock();
+      block->next = m_head;
+      if (m_head) m_head->prev = block.get();
+      m_head = block;
+      if (!m_tail) m_tail = block.get();
+    }
+    insertInBlock(m_head.get(), 0, value);
+    m_length++;
+  }
+
+  void pop_back() {
+    if (empty()) return;
+    if (--m_tail->count == 0) unlinkBlock(m_tail->prev, m_tail);
+    m_length--;
+  }
+
+  void pop_front() {
+    if (empty()) return;
+    eraseInBlock(m_head.get(), 0);
+    if (m_head->count == 0) unlinkBlock(nullptr, m_head.get());
+    m_length--;
+  }
+
+  /*
+  {0 1 3 4}
+  insert (2,10) // insert to index 2
+  {0 1 10 3 4}
+  */
+  void insert(size_t index, int value) {
+    if (index == 0) return push_front(value);
+    if (index >= m_length) return push_back(value);
+
+    size_t offset = index;
+    Block* block = blockAt(offset);
+    if (block->count == kBlockCapacity) {
+      // split the full block into two half full blocks.
+      auto second = createBlock();
+      size_t half = kBlockCapacity / 2;
+      std::copy(block->values + half, block->values + kBlockCapacity,
+                second->values);
+      second->count = kBlockCapacity - half;
+      block->count = half;
+      second->next = block->next;
+      second->prev = block;
+      if (second->next) second->next->prev = second.get();
+      block->next = second;
+      if (m_tail == block) m_tail = second.get();
+      if (offset > half) {
+        block = second.get();
+        offset -= half;
+      }
+    }
+    insertInBlock(block, offset, value);
+    m_length++;
+  }
+
+  void erase(size_t index) {
+    if (index >= m_length) return;
+
+    // keep the previous block around to unlink an empty block.
+    Block* prev = nullptr;
+    Block* block = m_head.get();
+    while (index >= block->count) {
+      index -= block->count;
+      prev = block;
+      block = block->next.get();
+    }
+
+    eraseInBlock(block, index);
+    m_length--;
+    if (block->count == 0) {
+      unlinkBlock(prev, block);
+    } else if (block->next &&
+               block->count + block->next->count <= kBlockCapacity / 2) {
+      mergeWithNext(block);
+    }
+  }
+
+  template <class _Pr1>
+  void remove_if(_Pr1 eval) {
+    // Compact each block in place, then drop the blocks which became empty
+    // and merge a block into the previous one when it fits and one of the two
+    // is under half full, so later scans do not visit near empty blocks.
+    Block* prev = nullptr;
+    Block* block = m_head.get();
+    while (block) {
+      auto end = std::remove_if(block->values, block->values + block->count,
+                                eval);
+      size_t kept = end - block->values;
+      m_length -= block->count - kept;
+      block->count = kept;
+
+      Block* next = block->next.get();
+      if (block->count == 0) {
+        unlinkBlock(prev, block);
+      } else if (prev && prev->count + block->count <= kBlockCapacity &&
+                 std::min(prev->count, block->count) < kBlockCapacity / 2) {
+        mergeWithNext(prev);
+      } else {
+        prev = block;
+      }
+      block = next;
+    }
+  }
+
+  void remove(int val) {
+    remove_if([val](int value) { return value == val; });
+  }
+
+  void reverse() {
+    if (!m_head) return;
+
+    BlockSharedPtr reversed;
+    m_tail = m_head.get();
+    auto block = m_head;
+    while (block) {
+      std::reverse(block->values, block->values + block->count);
+      auto next = block->next;
+      block->prev = next.get();
+      block->next = reversed;
+      reversed = block;
+      block = next;
+    }
+    m_head = reversed;
+  }
+
+  void clear() {
+    // unlink iteratively, a long block chain would recurse in ~UNode.
+    m_tail = nullptr;
+    while (m_head) {
+      m_head = std::move(m_head->next);
+    }
+    m_length = 0;
+  }
+
+  int at(size_t index) const {
+    const Block* block = blockAt(index);
+    return block->values[index];
+  }
+  size_t size() const { return m_length; }
+  bool empty() const { return m_length == 0; }
+  size_t block_count() const {
+    size_t count = 0;
+    for (auto block = m_head.get(); block; block = block->next.get()) count++;
+    return count;
+  }
+
+  const_iterator begin() const { return const_iterator(m_head.get(), 0); }
+  const_iterator end() const { return const_iterator(); }
+
+ private:
+  BlockSharedPtr createBlock() { return std::make_shared<Block>(); }
+
+  // Find the block holding index, index becomes the offset inside it.
+  Block* blockAt(size_t& index) const {
+    Block* block = m_head.get();
+    while (block && index >= block->count) {
+      index -= block->count;
+      block = block->next.get();
+    }
+    return block;
+  }
+
+  static void insertInBlock(Block* block, size_t offset, int value) {
+    std::copy_backward(block->values + offset, block->values + block->count,
+                       block->values + block->count + 1);
+    block->values[offset] = value;
+    block->count++;
+  }
+
+  static void eraseInBlock(Block* block, size_t offset) {
+    std::copy(block->values + offset + 1, block->values + block->count,
+              block->values + offset);
+    block->count--;
+  }
+
+  void mergeWithNext(Block* block) {
+    Block* next = block->next.get();
+    std::copy(next->values, next->values + next->count,
+              block->values + block->count);
+    block->count += next->count;
+    if (m_tail == next) m_tail = block;
+    block->next = next->next;
+    if (block->next) block->next->prev = block;
+  }
+
+  void unlinkBlock(Block* prev, Block* block) {
+    if (m_tail == block) m_tail = prev;
+    if (block->next) block->next->prev = prev;
+    if (prev) {
+      prev->next = block->next;
+    } else {
+      m_head = block->next;
+    }
+  }
+
+ private:
+  BlockSharedPtr m_head{nullptr};
+  Block* m_tail{nullptr};  // owned by the chain starting at m_head
+  size_t m_length{0};
+};
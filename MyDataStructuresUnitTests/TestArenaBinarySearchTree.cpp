@@ -0,0 +1,162 @@
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ArenaBinarySearchTree.h"
+#include "BinarySearcTree.h"
+#include "gmock\gmock.h"
+
+TEST(TestArenaBinarySearchTree, InsertLookup) {
+  // Preparations
+  ArenaBinarySearchTree<int> tree{5, 1, 9, 0, 2, 10, 7};
+
+  // Operation
+  EXPECT_TRUE(tree.insert(11));
+  EXPECT_FALSE(tree.insert(0));
+
+  // Tests
+  EXPECT_EQ(tree.size(), 8);
+  EXPECT_EQ(*tree.lookup(7), 7);
+  EXPECT_EQ(tree.lookup(8), nullptr);
+  EXPECT_TRUE(tree.contains(11));
+  EXPECT_EQ(tree.height(), 4);
+  EXPECT_EQ(sizeof(ArenaBinarySearchTree<int>::Node), 12);
+}
+
+TEST(TestArenaBinarySearchTree, Empty) {
+  ArenaBinarySearchTree<int> tree;
+  EXPECT_TRUE(tree.empty());
+  EXPECT_FALSE(tree.contains(0));
+  EXPECT_EQ(tree.height(), 0);
+  std::vector<int> none;
+  EXPECT_TRUE(ArenaBinarySearchTree<int>::from_sorted(none.begin(), none.end())
+                  .empty());
+}
+
+TEST(TestArenaBinarySearchTree, RandomAgainstSet) {
+  // Preparations, the arena grows many times while the tree is built
+  std::set<int> expected;
+  ArenaBinarySearchTree<int> tree;
+  std::mt19937 random(3);
+
+  // Operation
+  for (int i = 0; i < 20000; i++) {
+    int key = static_cast<int>(random() % 30000);
+    EXPECT_EQ(tree.insert(key), expected.insert(key).second);
+  }
+
+  // Tests
+  EXPECT_EQ(tree.size(), expected.size());
+  for (int key = -1; key <= 30000; key++) {
+    ASSERT_EQ(tree.contains(key), expected.count(key) == 1) << key;
+  }
+}
+
+// Key whose copy throws while throw_on_copy is set.
+struct ThrowingKey {
+  static bool throw_on_copy;
+  int value;
+  explicit ThrowingKey(int v) : value(v) {}
+  ThrowingKey(const ThrowingKey& other) : value(other.value) {
+    if (throw_on_copy) throw std::runtime_error("copy");
+  }
+  ThrowingKey& operator=(const ThrowingKey&) = default;
+  bool operator<(const ThrowingKey& other) const {
+    return value < other.value;
+  }
+};
+bool ThrowingKey::throw_on_copy = false;
+
+TEST(TestArenaBinarySearchTree, InsertThrowsLeavesTreeUnchanged) {
+  // Preparations
+  ArenaBinarySearchTree<ThrowingKey> tree;
+  tree.insert(ThrowingKey(5));
+  tree.insert(ThrowingKey(9));
+
+  // Operation, the failed key would go right of 9
+  ThrowingKey::throw_on_copy = true;
+  EXPECT_THROW(tree.insert(ThrowingKey(12)), std::runtime_error);
+  ThrowingKey::throw_on_copy = false;
+
+  // Tests, no link to the missing node is left behind
+  EXPECT_EQ(tree.size(), 2);
+  EXPECT_FALSE(tree.contains(ThrowingKey(12)));
+  EXPECT_EQ(tree.height(), 2);
+  EXPECT_TRUE(tree.insert(ThrowingKey(12)));
+  EXPECT_TRUE(tree.contains(ThrowingKey(12)));
+  EXPECT_EQ(tree.height(), 3);
+}
+
+TEST(TestArenaBinarySearchTree, FromSorted) {
+  // Preparations
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; i++) keys.push_back(std::to_string(10000 + i));
+
+  // Operation
+  auto tree =
+      ArenaBinarySearchTree<std::string>::from_sorted(keys.begin(), keys.end());
+
+  // Tests, perfectly balanced: 1000 keys fit in 10 levels
+  EXPECT_EQ(tree.size(), 1000);
+  EXPECT_EQ(tree.height(), 10);
+  for (const auto& key : keys) EXPECT_EQ(*tree.lookup(key), key);
+  EXPECT_FALSE(tree.contains("1"));
+  EXPECT_TRUE(tree.insert("1"));
+  EXPECT_EQ(tree.height(), 11);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestArenaBinarySearchTree, DISABLED_BenchmarkMemoryAndLookup) {
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+  const int kQueries = 2000000;
+
+  for (int n : {1000000, 4000000}) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = 2 * i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    std::vector<int> queries(kQueries);
+    std::mt19937 random(2);
+    for (auto& query : queries) query = static_cast<int>(random() % (2 * n));
+
+    // same insertion order, so both trees have the same shape
+    BinarySearchTree bst;
+    for (int key : keys) bst.insert(key);
+    ArenaBinarySearchTree<int> arena;
+    arena.reserve(n);
+    for (int key : keys) arena.insert(key);
+
+    // a make_shared block holds the node and a 16 byte control block (vtable
+    // pointer and two 32 bit counters with libstdc++ on LP64)
+    std::cout << n << " keys, bytes/key: BinarySearchTree "
+              << sizeof(BNode) + 16 << " + allocator overhead, Arena "
+              << double(arena.memory_usage()) / n << std::endl;
+
+    auto report = [&](const char* name, std::function<size_t()> run) {
+      auto start = Clock::now();
+      size_t found = run();
+      double mlps = kQueries / seconds(Clock::now() - start) / 1e6;
+      std::cout << n << " keys, " << name << ": " << mlps
+                << " M lookups/s (found " << found << ")" << std::endl;
+    };
+    report("BinarySearchTree", [&] {
+      size_t found = 0;
+      for (int query : queries) found += bst.lookup(query) != nullptr;
+      return found;
+    });
+    report("ArenaBinarySearchTree", [&] {
+      size_t found = 0;
+      for (int query : queries) found += arena.contains(query);
+      return found;
+    });
+  }
+}
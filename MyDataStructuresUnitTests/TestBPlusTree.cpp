@@ -0,0 +1,166 @@
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+#include "BPlusTree.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+
+TEST(TestBPlusTree, InsertLookup) {
+  // Preparations
+  BPlusTree tree{5, 1, 9, 0, 2, 10, 7};
+
+  // Operation
+  EXPECT_TRUE(tree.insert(11));
+  EXPECT_FALSE(tree.insert(0));
+
+  // Tests
+  ASSERT_THAT(tree, ElementsAre(0, 1, 2, 5, 7, 9, 10, 11));
+  EXPECT_EQ(tree.size(), 8);
+  EXPECT_EQ(*tree.lookup(7), 7);
+  EXPECT_EQ(tree.lookup(8), nullptr);
+  EXPECT_TRUE(tree.contains(11));
+  EXPECT_EQ(tree.depth(), 0);
+}
+
+TEST(TestBPlusTree, Empty) {
+  BPlusTree tree;
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(tree.begin(), tree.end());
+  EXPECT_EQ(tree.lookup(1), nullptr);
+  EXPECT_EQ(tree.lower_bound(1), tree.end());
+}
+
+TEST(TestBPlusTree, SortedAndReverseInsert) {
+  // Preparations
+  BPlusTree ascending;
+  BPlusTree descending;
+  const int N = 100000;
+
+  // Operation, enough keys for several inner levels
+  for (int i = 0; i < N; i++) {
+    EXPECT_TRUE(ascending.insert(i));
+    EXPECT_TRUE(descending.insert(N - 1 - i));
+  }
+
+  // Tests
+  EXPECT_GE(ascending.depth(), 2);
+  EXPECT_EQ(ascending.size(), N);
+  std::vector<int> expected(N);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_TRUE(std::equal(ascending.begin(), ascending.end(), expected.begin(),
+                         expected.end()));
+  EXPECT_TRUE(std::equal(descending.begin(), descending.end(),
+                         expected.begin(), expected.end()));
+  for (int i = 0; i < N; i += 97) EXPECT_EQ(*descending.lookup(i), i);
+}
+
+TEST(TestBPlusTree, RandomInsertAgainstSet) {
+  // Preparations
+  BPlusTree tree;
+  std::set<int> expected;
+  std::mt19937 random(3);
+
+  // Operation
+  for (int i = 0; i < 50000; i++) {
+    int key = static_cast<int>(random() % 100000) - 50000;
+    EXPECT_EQ(tree.insert(key), expected.insert(key).second);
+  }
+  EXPECT_TRUE(tree.insert(INT_MAX));
+  EXPECT_TRUE(tree.insert(INT_MIN));
+  expected.insert(INT_MAX);
+  expected.insert(INT_MIN);
+
+  // Tests
+  EXPECT_TRUE(
+      std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+  for (int key = -50010; key < 50010; key += 3) {
+    auto it = tree.lower_bound(key);
+    EXPECT_EQ(*it, *expected.lower_bound(key)) << key;
+    EXPECT_EQ(tree.contains(key), expected.count(key) == 1) << key;
+  }
+  EXPECT_EQ(*tree.lookup(INT_MAX), INT_MAX);
+  EXPECT_EQ(*tree.begin(), INT_MIN);
+}
+
+TEST(TestBPlusTree, Move) {
+  BPlusTree tree{1, 2, 3};
+  BPlusTree moved(std::move(tree));
+  ASSERT_THAT(moved, ElementsAre(1, 2, 3));
+  EXPECT_TRUE(tree.empty());
+  tree = std::move(moved);
+  ASSERT_THAT(tree, ElementsAre(1, 2, 3));
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBPlusTree, DISABLED_BenchmarkLookupAndScan) {
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+  const int kQueries = 2000000;
+  const int kScanLength = 100;
+
+  for (int n : {1000000, 10000000}) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = 2 * i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    std::vector<int> queries(kQueries);
+    std::mt19937 random(2);
+    for (auto& query : queries) query = static_cast<int>(random() % (2 * n));
+
+    auto start = Clock::now();
+    BPlusTree tree;
+    for (int key : keys) tree.insert(key);
+    double tree_insert = seconds(Clock::now() - start);
+    start = Clock::now();
+    std::set<int> set;
+    for (int key : keys) set.insert(key);
+    double set_insert = seconds(Clock::now() - start);
+    std::cout << n << " keys, random insert: BPlusTree " << tree_insert
+              << " s, std::set " << set_insert << " s" << std::endl;
+
+    auto report = [&](const char* name, int per_query,
+                      std::function<long long()> run) {
+      auto begin = Clock::now();
+      long long checksum = run();
+      double rate = kQueries / seconds(Clock::now() - begin) / 1e6;
+      std::cout << n << " keys, " << name << ": " << rate * per_query
+                << " M keys/s (checksum " << checksum << ")" << std::endl;
+    };
+    report("BPlusTree lookup", 1, [&] {
+      long long found = 0;
+      for (int query : queries) found += tree.contains(query);
+      return found;
+    });
+    report("std::set lookup", 1, [&] {
+      long long found = 0;
+      for (int query : queries) found += set.count(query);
+      return found;
+    });
+    report("BPlusTree range scan", kScanLength, [&] {
+      long long sum = 0;
+      for (int query : queries) {
+        auto it = tree.lower_bound(query);
+        for (int i = 0; i < kScanLength && it != tree.end(); i++) sum += *it++;
+      }
+      return sum;
+    });
+    report("std::set range scan", kScanLength, [&] {
+      long long sum = 0;
+      for (int query : queries) {
+        auto it = set.lower_bound(query);
+        for (int i = 0; i < kScanLength && it != set.end(); i++) sum += *it++;
+      }
+      return sum;
+    });
+  }
+}
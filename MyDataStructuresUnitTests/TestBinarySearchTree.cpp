@@ -1,8 +1,24 @@
 ﻿#include "pch.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "BinarySearcTree.h"
 #include "gmock\gmock.h"
 
+using testing::ElementsAre;
+
 BinarySearchTree create_tree() {
   /*
           5
@@ -101,3 +117,953 @@ TEST(TestBinarySearchTree, Root) {
   BinarySearchTree bst_init(5);
   ASSERT_THAT(bst_init.root(), NodeWithNoChild(5));
 }
+
+// Checks order, parent links, stored heights and the AVL balance, returns the
+// height.
+static int check_avl(const BNodeSharedPtr& node, long long low,
+                     long long high) {
+  if (!node) return 0;
+  EXPECT_GT(node->value, low);
+  EXPECT_LT(node->value, high);
+  if (node->left) {
+    EXPECT_EQ(node->left->parent, node.get());
+  }
+  if (node->right) {
+    EXPECT_EQ(node->right->parent, node.get());
+  }
+  int left = check_avl(node->left, low, node->value);
+  int right = check_avl(node->right, node->value, high);
+  EXPECT_LE(std::abs(left - right), 1) << "at " << node->value;
+  EXPECT_EQ(node->height, 1 + std::max(left, right)) << "at " << node->value;
+  return 1 + std::max(left, right);
+}
+
+TEST(TestBinarySearchTree, AvlSortedInsert) {
+  // Preparations
+  BinarySearchTree bst(BalanceMode::kAvl);
+  BinarySearchTree plain;
+
+  // Operation, 1023 sorted values give a perfect tree
+  for (int i = 0; i < 1023; i++) {
+    EXPECT_TRUE(bst.insert(i));
+    plain.insert(i);
+  }
+
+  // Tests
+  EXPECT_EQ(bst.height(), 10);
+  EXPECT_EQ(check_avl(bst.root(), -1, 1023), 10);
+  EXPECT_EQ(bst.root()->value, 511);
+  EXPECT_EQ(plain.height(), 1023);
+  EXPECT_FALSE(bst.insert(7));
+  ASSERT_THAT(bst.lookup(100), NodeValue(100));
+  EXPECT_EQ(bst.lookup(1023), nullptr);
+}
+
+TEST(TestBinarySearchTree, AvlRotations) {
+  // Left-right and right-left cases end with the middle value on top
+  BinarySearchTree left_right({3, 1, 2}, BalanceMode::kAvl);
+  ASSERT_THAT(left_right.root(), NodeIs(2, 1, 3));
+  BinarySearchTree right_left({1, 3, 2}, BalanceMode::kAvl);
+  ASSERT_THAT(right_left.root(), NodeIs(2, 1, 3));
+  BinarySearchTree descending({3, 2, 1}, BalanceMode::kAvl);
+  ASSERT_THAT(descending.root(), NodeIs(2, 1, 3));
+
+  // The insertion order shape of create_tree() is already balanced
+  BinarySearchTree bst({5, 1, 9, 0, 2, 10, 7}, BalanceMode::kAvl);
+  check_tree(bst);
+}
+
+TEST(TestBinarySearchTree, AvlRandomInsert) {
+  BinarySearchTree bst(BalanceMode::kAvl);
+  std::set<int> expected;
+  std::mt19937 random(7);
+  for (int i = 0; i < 5000; i++) {
+    int value = static_cast<int>(random() % 10000);
+    EXPECT_EQ(bst.insert(value), expected.insert(value).second);
+  }
+
+  int height = check_avl(bst.root(), -1, 10000);
+  EXPECT_LE(height, 1.44 * std::log2(expected.size() + 2));
+  for (int value = 0; value < 10000; value++) {
+    EXPECT_EQ(bst.lookup(value) != nullptr, expected.count(value) == 1);
+  }
+}
+
+TEST(TestBinarySearchTree, CopyIsDeep) {
+  // Preparations
+  BinarySearchTree original({1, 2, 3}, BalanceMode::kAvl);
+  BinarySearchTree assigned;
+
+  // Operation, rotations and erases in the copies
+  BinarySearchTree copy = original;
+  assigned = original;
+  for (int value = 4; value <= 10; value++) copy.insert(value);
+  copy.erase(1);
+  assigned.erase(2);
+
+  // Tests
+  EXPECT_THAT(original, ElementsAre(1, 2, 3));
+  EXPECT_EQ(original.size(), 3);
+  EXPECT_EQ(check_avl(original.root(), 0, 4), 2);
+  EXPECT_EQ(original.root()->size, 3);
+  EXPECT_THAT(copy, ElementsAre(2, 3, 4, 5, 6, 7, 8, 9, 10));
+  check_avl(copy.root(), 0, 11);
+  EXPECT_THAT(assigned, ElementsAre(1, 3));
+  EXPECT_EQ(assigned.balance_mode(), BalanceMode::kAvl);
+
+  BinarySearchTree moved = std::move(copy);
+  EXPECT_EQ(moved.size(), 9);
+  EXPECT_TRUE(copy.empty());
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkBalancedInsert) {
+  const int N = 1000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  std::vector<int> sorted(N);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  std::vector<int> reversed(sorted.rbegin(), sorted.rend());
+  std::vector<int> shuffled = sorted;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+  auto run = [&](const char* name, const std::vector<int>& values) {
+    auto start = Clock::now();
+    BinarySearchTree bst(BalanceMode::kAvl);
+    for (int value : values) bst.insert(value);
+    auto insert = ms(Clock::now() - start);
+    start = Clock::now();
+    int found = 0;
+    for (int value : shuffled) found += bst.lookup(value) != nullptr;
+    auto lookup = ms(Clock::now() - start);
+
+    start = Clock::now();
+    std::set<int> set;
+    for (int value : values) set.insert(value);
+    auto set_insert = ms(Clock::now() - start);
+    start = Clock::now();
+    int set_found = 0;
+    for (int value : shuffled) set_found += set.count(value);
+    auto set_lookup = ms(Clock::now() - start);
+
+    EXPECT_EQ(found, set_found);
+    std::cout << name << " " << N << ": AVL insert " << insert
+              << " ms, lookup " << lookup << " ms (height " << bst.height()
+              << "); std::set insert " << set_insert << " ms, lookup "
+              << set_lookup << " ms" << std::endl;
+  };
+  run("sorted", sorted);
+  run("reverse sorted", reversed);
+  run("random", shuffled);
+
+  // The unbalanced tree on sorted input, a much smaller n is enough.
+  const int kSmall = 5000;
+  auto start = Clock::now();
+  BinarySearchTree plain;
+  for (int i = 0; i < kSmall; i++) plain.insert(i);
+  for (int i = 0; i < kSmall; i++) plain.lookup(i);
+  std::cout << "unbalanced sorted " << kSmall << ": insert + lookup "
+            << ms(Clock::now() - start) << " ms (height " << plain.height()
+            << ")" << std::endl;
+}
+
+TEST(TestBinarySearchTree, TryEmplace) {
+  // Preparations
+  BasicBinarySearchTree<int, std::string> tree;
+
+  // Operation
+  auto first = tree.try_emplace(2, "two");
+  auto second = tree.try_emplace(2, "zwei");
+  tree.try_emplace(1, 3, 'a');
+
+  // Tests, the second try leaves the value alone
+  EXPECT_TRUE(first.second);
+  EXPECT_FALSE(second.second);
+  EXPECT_EQ(second.first, first.first);
+  EXPECT_EQ(tree.lookup(2)->mapped, "two");
+  EXPECT_EQ(tree.lookup(1)->mapped, "aaa");
+  EXPECT_EQ(tree.lookup(3), nullptr);
+}
+
+TEST(TestBinarySearchTree, InsertOrAssign) {
+  BasicBinarySearchTree<std::string, int> tree(BalanceMode::kAvl);
+
+  EXPECT_TRUE(tree.insert_or_assign("b", 1).second);
+  EXPECT_TRUE(tree.insert_or_assign("a", 2).second);
+  EXPECT_TRUE(tree.insert_or_assign("c", 3).second);
+  auto result = tree.insert_or_assign("a", 20);
+
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(result.first->mapped, 20);
+  EXPECT_EQ(tree.lookup("a")->mapped, 20);
+  EXPECT_EQ(tree.root()->value, "b");
+  EXPECT_TRUE(tree.insert("d"));
+  EXPECT_EQ(tree.lookup("d")->mapped, 0);
+}
+
+TEST(TestBinarySearchTree, TransparentLookup) {
+  // Preparations
+  BasicBinarySearchTree<std::string, int, std::less<>> tree;
+  tree.insert_or_assign("apple", 1);
+  tree.insert_or_assign("pear", 2);
+  std::string text = "pear,apple,plum";
+
+  // Operation, the keys are views into text, no std::string is built
+  std::string_view pear(text.data(), 4);
+  std::string_view apple(text.data() + 5, 5);
+  std::string_view plum(text.data() + 11, 4);
+
+  // Tests
+  EXPECT_EQ(tree.lookup(pear)->mapped, 2);
+  EXPECT_EQ(tree.lookup(apple)->mapped, 1);
+  EXPECT_EQ(tree.lookup(plum), nullptr);
+  EXPECT_EQ(tree.lookup("pear")->mapped, 2);
+}
+
+TEST(TestBinarySearchTree, CustomCompare) {
+  // Preparations
+  struct Point {
+    double x, y;
+    Point(double x, double y) : x(x), y(y){};
+  };
+
+  // compare 2 points with respect to origin
+  struct PointCmp {
+    bool operator()(const Point& lhs, const Point& rhs) const {
+      return std::hypot(lhs.x, lhs.y) < std::hypot(rhs.x, rhs.y);
+    }
+  };
+
+  // Operation
+  BasicBinarySearchTree<Point, std::string, PointCmp> tree;
+  tree.try_emplace(Point(3, 4), "five");
+  tree.try_emplace(Point(1, 1), "small");
+  // same distance as (3, 4), so the same key
+  auto result = tree.try_emplace(Point(4, 3), "other five");
+
+  // Tests
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(tree.lookup(Point(0, 5))->mapped, "five");
+  EXPECT_EQ(tree.lookup(Point(-1, 1))->mapped, "small");
+  EXPECT_EQ(tree.lookup(Point(0, 1)), nullptr);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkStringLookup) {
+  const int N = 1000000;
+  const int kQueries = 2000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  // keys "key<number>", queries are views into one text buffer
+  std::mt19937 random(5);
+  std::vector<std::string> keys;
+  for (int i = 0; i < N; i++) keys.push_back("key" + std::to_string(random()));
+  std::string text;
+  std::vector<std::pair<size_t, size_t>> spans;
+  for (int i = 0; i < kQueries; i++) {
+    const std::string& key = keys[random() % N];
+    spans.emplace_back(text.size(), key.size());
+    text += key;
+  }
+
+  BasicBinarySearchTree<std::string, int, std::less<>> tree(BalanceMode::kAvl);
+  std::map<std::string, int, std::less<>> transparent_map;
+  std::map<std::string, int> map;
+  for (int i = 0; i < N; i++) {
+    tree.insert_or_assign(keys[i], i);
+    transparent_map.insert_or_assign(keys[i], i);
+    map.insert_or_assign(keys[i], i);
+  }
+
+  auto run = [&](const char* name, std::function<long long(std::string_view)>
+                                        find) {
+    auto start = Clock::now();
+    long long sum = 0;
+    for (auto& span : spans) {
+      sum += find(std::string_view(text.data() + span.first, span.second));
+    }
+    std::cout << name << ": " << ms(Clock::now() - start) << " ms for "
+              << kQueries << " lookups (sum " << sum << ")" << std::endl;
+  };
+  run("BasicBinarySearchTree<string, int, less<>> AVL",
+      [&](std::string_view key) { return tree.lookup(key)->mapped; });
+  run("std::map<string, int, less<>>", [&](std::string_view key) {
+    return transparent_map.find(key)->second;
+  });
+  run("std::map<string, int> + std::string(key)", [&](std::string_view key) {
+    return map.find(std::string(key))->second;
+  });
+}
+
+TEST(TestBinarySearchTree, FromSorted) {
+  // Preparations
+  std::vector<int> sorted{0, 1, 2, 5, 7, 9, 10};
+
+  // Operation
+  auto bst = BinarySearchTree::from_sorted(sorted.begin(), sorted.end());
+
+  // Tests, the middle elements become the roots
+  ASSERT_THAT(bst.root(), NodeIs(5, 1, 9));
+  ASSERT_THAT(bst.lookup(1), NodeIs(1, 0, 2));
+  ASSERT_THAT(bst.lookup(9), NodeIs(9, 7, 10));
+  EXPECT_EQ(bst.size(), 7);
+  EXPECT_EQ(check_avl(bst.root(), -1, 11), 3);
+
+  std::vector<int> large(100000);
+  std::iota(large.begin(), large.end(), 0);
+  auto balanced = BinarySearchTree::from_sorted(large.begin(), large.end(),
+                                                BalanceMode::kAvl);
+  EXPECT_EQ(check_avl(balanced.root(), -1, 100000), 17);
+  EXPECT_TRUE(balanced.insert(100000));
+  EXPECT_EQ(check_avl(balanced.root(), -1, 100001), 17);
+  EXPECT_TRUE(BinarySearchTree::from_sorted(large.end(), large.end()).empty());
+}
+
+TEST(TestBinarySearchTree, FromSortedPairs) {
+  std::map<std::string, int> values{{"a", 1}, {"b", 2}, {"c", 3}};
+
+  auto tree = BasicBinarySearchTree<std::string, int>::from_sorted(
+      values.begin(), values.end());
+
+  EXPECT_EQ(tree.root()->value, "b");
+  EXPECT_EQ(tree.lookup("a")->mapped, 1);
+  EXPECT_EQ(tree.lookup("c")->mapped, 3);
+}
+
+TEST(TestBinarySearchTree, BulkInsert) {
+  // Preparations
+  BasicBinarySearchTree<int, std::string> tree;
+  tree.try_emplace(5, "five");
+  tree.try_emplace(1, "one");
+  std::vector<std::pair<int, std::string>> batch{
+      {9, "nine"}, {5, "FIVE"}, {0, "zero"}, {9, "NINE"}, {2, "two"}};
+
+  // Operation, the batch is bigger than the tree: merge and relink
+  tree.bulk_insert(batch.begin(), batch.end());
+
+  // Tests, existing keys and the first of a repeated key win
+  EXPECT_EQ(tree.size(), 5);
+  EXPECT_EQ(tree.root()->value, 2);
+  EXPECT_EQ(tree.lookup(5)->mapped, "five");
+  EXPECT_EQ(tree.lookup(9)->mapped, "nine");
+  EXPECT_EQ(tree.lookup(0)->mapped, "zero");
+
+  // A small batch goes in one by one
+  std::vector<int> large(1000);
+  std::iota(large.begin(), large.end(), 0);
+  auto bst = BinarySearchTree::from_sorted(large.begin(), large.end());
+  std::vector<int> small{2000, 3, 1500};
+  bst.bulk_insert(small.begin(), small.end());
+  EXPECT_EQ(bst.size(), 1002);
+  EXPECT_NE(bst.lookup(1500), nullptr);
+  EXPECT_EQ(bst.root()->value, 500);
+}
+
+// Throws when 42 is compared with a key of 100 or more.
+struct ThrowingLess {
+  bool operator()(int lhs, int rhs) const {
+    if ((lhs == 42 && rhs >= 100) || (rhs == 42 && lhs >= 100))
+      throw std::runtime_error("compare");
+    return lhs < rhs;
+  }
+};
+
+TEST(TestBinarySearchTree, BulkInsertThrowLeavesTree) {
+  // Preparations
+  std::vector<int> keys(100);
+  std::iota(keys.begin(), keys.end(), 100);
+  auto tree = BasicBinarySearchTree<int, NoMapped, ThrowingLess>::from_sorted(
+      keys.begin(), keys.end());
+  std::vector<int> batch(200);
+  std::iota(batch.begin(), batch.end(), -157);
+
+  // Operation, the merge throws after some new nodes were made
+  EXPECT_THROW(tree.bulk_insert(batch.begin(), batch.end()),
+               std::runtime_error);
+
+  // Tests, the tree is untouched
+  EXPECT_EQ(tree.size(), 100);
+  EXPECT_TRUE(std::equal(tree.begin(), tree.end(), keys.begin(), keys.end()));
+  EXPECT_EQ(tree.root()->size, 100);
+  EXPECT_EQ(*tree.select(50), 150);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkBulkLoad) {
+  const int N = 10000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+  std::vector<int> sorted(N);
+  std::iota(sorted.begin(), sorted.end(), 0);
+
+  auto start = Clock::now();
+  {
+    BinarySearchTree bst(BalanceMode::kAvl);
+    for (int key : sorted) bst.insert(key);
+    std::cout << N << " sorted keys, AVL insert: " << ms(Clock::now() - start)
+              << " ms" << std::endl;
+  }
+  start = Clock::now();
+  {
+    auto bst = BinarySearchTree::from_sorted(sorted.begin(), sorted.end());
+    std::cout << N << " sorted keys, from_sorted: "
+              << ms(Clock::now() - start) << " ms" << std::endl;
+  }
+
+  // Half of the keys in the tree, the other half comes as a shuffled batch
+  std::vector<int> even, odd;
+  for (int key : sorted) (key % 2 ? odd : even).push_back(key);
+  std::shuffle(odd.begin(), odd.end(), std::mt19937(1));
+  {
+    auto bst = BinarySearchTree::from_sorted(even.begin(), even.end(),
+                                             BalanceMode::kAvl);
+    start = Clock::now();
+    for (int key : odd) bst.insert(key);
+    std::cout << N / 2 << " random keys into " << N / 2
+              << ", AVL insert: " << ms(Clock::now() - start) << " ms"
+              << std::endl;
+  }
+  {
+    auto bst = BinarySearchTree::from_sorted(even.begin(), even.end(),
+                                             BalanceMode::kAvl);
+    start = Clock::now();
+    bst.bulk_insert(odd.begin(), odd.end());
+    std::cout << N / 2 << " random keys into " << N / 2
+              << ", bulk_insert: " << ms(Clock::now() - start) << " ms"
+              << std::endl;
+  }
+}
+
+TEST(TestBinarySearchTree, Iterator) {
+  // Preparations
+  BinarySearchTree bst = create_tree();
+  BinarySearchTree balanced({5, 1, 9, 0, 2, 10, 7, 3, 4, 6}, BalanceMode::kAvl);
+
+  // Tests, in order both ways
+  ASSERT_THAT(bst, ElementsAre(0, 1, 2, 5, 7, 9, 10));
+  std::vector<int> backwards(std::make_reverse_iterator(bst.end()),
+                             std::make_reverse_iterator(bst.begin()));
+  ASSERT_THAT(backwards, ElementsAre(10, 9, 7, 5, 2, 1, 0));
+  ASSERT_THAT(balanced, ElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 9, 10));
+  EXPECT_EQ(*--balanced.end(), 10);
+  EXPECT_EQ(balanced.root()->parent, nullptr);
+  check_avl(balanced.root(), -1, 11);
+  EXPECT_EQ(BinarySearchTree().begin(), BinarySearchTree().end());
+
+  // mapped values through the node
+  BasicBinarySearchTree<int, int> map;
+  map.insert_or_assign(2, 20);
+  map.insert_or_assign(1, 10);
+  int sum = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) sum += it.node()->mapped;
+  EXPECT_EQ(sum, 30);
+}
+
+TEST(TestBinarySearchTree, LowerBound) {
+  BinarySearchTree bst{30, 10, 50, 0, 20, 40, 60, 70};
+
+  auto it_lower = bst.lower_bound(20);
+  EXPECT_EQ(*it_lower, 20);
+
+  it_lower = bst.lower_bound(19);
+  EXPECT_EQ(*it_lower, 20);
+
+  it_lower = bst.lower_bound(21);
+  EXPECT_EQ(*it_lower, 30);
+
+  EXPECT_EQ(bst.lower_bound(71), bst.end());
+}
+
+TEST(TestBinarySearchTree, UpperBound) {
+  BinarySearchTree bst{30, 10, 50, 0, 20, 40, 60, 70};
+  auto it_upper = bst.upper_bound(20);
+  EXPECT_EQ(*it_upper, 30);
+
+  it_upper = bst.upper_bound(19);
+  EXPECT_EQ(*it_upper, 20);
+
+  it_upper = bst.upper_bound(21);
+  EXPECT_EQ(*it_upper, 30);
+
+  // all keys in [20, 50]
+  std::vector<int> range(bst.lower_bound(20), bst.upper_bound(50));
+  ASSERT_THAT(range, ElementsAre(20, 30, 40, 50));
+  EXPECT_EQ(bst.upper_bound(70), bst.end());
+}
+
+TEST(TestBinarySearchTree, EqualRange) {
+  BinarySearchTree bst({10, 20, 30, 40, 50}, BalanceMode::kAvl);
+
+  auto ret = bst.equal_range(30);
+  EXPECT_EQ(*ret.first, 30);   // lower_bound;
+  EXPECT_EQ(*ret.second, 40);  // upper_bound;
+
+  // if value not found
+  ret = bst.equal_range(60);
+  EXPECT_EQ(ret.first, bst.end());   // lower_bound;
+  EXPECT_EQ(ret.second, bst.end());  // upper_bound;
+
+  ret = bst.equal_range(35);
+  EXPECT_EQ(ret.first, ret.second);
+  EXPECT_EQ(*ret.first, 40);
+}
+
+TEST(TestBinarySearchTree, RangeAfterBulkInsert) {
+  std::vector<int> even(50), odd(50);
+  for (int i = 0; i < 50; i++) {
+    even[i] = 2 * i;
+    odd[i] = 2 * i + 1;
+  }
+  auto bst = BinarySearchTree::from_sorted(even.begin(), even.end(),
+                                           BalanceMode::kAvl);
+  std::shuffle(odd.begin(), odd.end(), std::mt19937(4));
+  bst.bulk_insert(odd.begin(), odd.end());
+
+  check_avl(bst.root(), -1, 100);
+  std::vector<int> expected(100);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_TRUE(std::equal(bst.begin(), bst.end(), expected.begin(),
+                         expected.end()));
+  EXPECT_EQ(std::distance(bst.lower_bound(10), bst.lower_bound(20)), 10);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkRangeScan) {
+  const int N = 1000000;
+  const int kQueries = 200000;
+  const int kRange = 200;  // keys are 2 apart, about 100 keys per query
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+
+  std::vector<int> keys(N);
+  for (int i = 0; i < N; i++) keys[i] = 2 * i;
+  std::vector<int> shuffled = keys;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+  BinarySearchTree avl(BalanceMode::kAvl);
+  for (int key : shuffled) avl.insert(key);
+  auto packed = BinarySearchTree::from_sorted(keys.begin(), keys.end());
+  std::set<int> set(shuffled.begin(), shuffled.end());
+  std::vector<int> starts(kQueries);
+  std::mt19937 random(2);
+  for (auto& start : starts) start = static_cast<int>(random() % (2 * N));
+
+  auto run = [&](const char* name, auto& container) {
+    auto start = Clock::now();
+    long long keys_seen = 0, sum = 0;
+    for (int first : starts) {
+      auto end = container.lower_bound(first + kRange);
+      for (auto it = container.lower_bound(first); it != end; ++it) {
+        sum += *it;
+        keys_seen++;
+      }
+    }
+    std::cout << name << ": " << keys_seen / seconds(Clock::now() - start) / 1e6
+              << " M keys/s (sum " << sum << ")" << std::endl;
+  };
+  run("BinarySearchTree AVL, random inserts", avl);
+  run("BinarySearchTree from_sorted", packed);
+  run("std::set", set);
+}
+
+TEST(TestBinarySearchTree, EraseKey) {
+  // Preparations
+  BinarySearchTree bst = create_tree();
+
+  // Operation, a leaf, a node with two children and the root
+  EXPECT_EQ(bst.erase(0), 1);
+  EXPECT_EQ(bst.erase(9), 1);
+  EXPECT_EQ(bst.erase(5), 1);
+  EXPECT_EQ(bst.erase(5), 0);
+
+  // Tests, the successors took the places of 9 and 5
+  EXPECT_THAT(bst, ElementsAre(1, 2, 7, 10));
+  EXPECT_EQ(bst.size(), 4);
+  EXPECT_EQ(bst.root()->value, 7);
+  ASSERT_THAT(bst.root()->right, NodeWithNoChild(10));
+  EXPECT_EQ(bst.root()->left->parent, bst.root().get());
+  EXPECT_EQ(bst.lookup(9), nullptr);
+}
+
+TEST(TestBinarySearchTree, EraseIterator) {
+  // Preparations
+  BinarySearchTree bst({5, 1, 9, 0, 2, 10, 7}, BalanceMode::kAvl);
+  auto seven = bst.lookup(7);
+
+  // Operation
+  auto next = bst.erase(bst.lower_bound(5));
+
+  // Tests, 7 was relinked in place of 5, not copied
+  EXPECT_EQ(*next, 7);
+  EXPECT_EQ(next.node(), seven.get());
+  EXPECT_EQ(bst.root(), seven);
+  EXPECT_EQ(bst.erase(std::prev(bst.end())), bst.end());
+  EXPECT_THAT(bst, ElementsAre(0, 1, 2, 7, 9));
+  check_avl(bst.root(), -1, 11);
+}
+
+TEST(TestBinarySearchTree, EraseRange) {
+  // Preparations
+  BinarySearchTree small_range({5, 1, 9, 0, 2, 10, 7}, BalanceMode::kAvl);
+  std::vector<int> keys(1000);
+  std::iota(keys.begin(), keys.end(), 0);
+  auto big_range = BinarySearchTree::from_sorted(keys.begin(), keys.end(),
+                                                 BalanceMode::kAvl);
+
+  // Operation, AVL trees go key by key
+  auto small_last = small_range.erase(small_range.lower_bound(1),
+                                      small_range.lower_bound(7));
+  auto big_last =
+      big_range.erase(big_range.lower_bound(10), big_range.lower_bound(990));
+
+  // Tests
+  EXPECT_EQ(*small_last, 7);
+  EXPECT_THAT(small_range, ElementsAre(0, 7, 9, 10));
+  check_avl(small_range.root(), -1, 11);
+  EXPECT_EQ(*big_last, 990);
+  EXPECT_EQ(big_range.size(), 20);
+  EXPECT_EQ(*std::next(big_range.begin(), 10), 990);
+  EXPECT_LE(check_avl(big_range.root(), -1, 1000), 6);
+  EXPECT_EQ(big_range.erase(big_range.begin(), big_range.end()),
+            big_range.end());
+  EXPECT_TRUE(big_range.empty());
+  EXPECT_EQ(big_range.root(), nullptr);
+}
+
+TEST(TestBinarySearchTree, EraseTransparent) {
+  BasicBinarySearchTree<std::string, int, std::less<>> map;
+  map.insert_or_assign("one", 1);
+  map.insert_or_assign("two", 2);
+  EXPECT_EQ(map.erase(std::string_view("one")), 1);
+  EXPECT_EQ(map.erase("three"), 0);
+  EXPECT_THAT(map, ElementsAre("two"));
+}
+
+TEST(TestBinarySearchTree, AvlRandomChurn) {
+  // Preparations
+  BinarySearchTree avl(BalanceMode::kAvl);
+  BinarySearchTree plain;
+  std::set<int> expected;
+  std::mt19937 random(11);
+
+  // Operation, inserts and erases at random, the size stays about 1000
+  for (int i = 0; i < 20000; i++) {
+    int value = static_cast<int>(random() % 2000);
+    if (random() % 2) {
+      EXPECT_EQ(avl.insert(value), expected.insert(value).second);
+      plain.insert(value);
+    } else {
+      EXPECT_EQ(avl.erase(value), expected.erase(value));
+      plain.erase(value);
+    }
+  }
+
+  // Tests
+  int height = check_avl(avl.root(), -1, 2000);
+  EXPECT_LE(height, 1.44 * std::log2(expected.size() + 2));
+  EXPECT_EQ(avl.size(), expected.size());
+  EXPECT_EQ(plain.size(), expected.size());
+  EXPECT_TRUE(std::equal(avl.begin(), avl.end(), expected.begin(),
+                         expected.end()));
+  EXPECT_TRUE(std::equal(plain.begin(), plain.end(), expected.begin(),
+                         expected.end()));
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkSlidingWindow) {
+  // Every step inserts a new key and erases the one inserted kWindow steps
+  // earlier, keys are random so the tree keeps its shape.
+  const int kWindow = 1000000;
+  const int kSteps = 2000000;
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+
+  auto run = [&](const char* name, auto& container) {
+    std::mt19937 random(3);
+    std::deque<int> window;
+    auto start = Clock::now();
+    for (int step = 0; step < kWindow + kSteps; step++) {
+      int key = static_cast<int>(random());
+      if (container.insert(key).second) window.push_back(key);
+      if (window.size() > static_cast<size_t>(kWindow)) {
+        container.erase(window.front());
+        window.pop_front();
+      }
+    }
+    std::cout << name << ": " << (kWindow + kSteps) /
+                     seconds(Clock::now() - start) / 1e6
+              << " M steps/s, " << container.size() << " keys" << std::endl;
+  };
+  // insert returns bool for the tree, a pair for std::set
+  struct AvlAdapter {
+    std::pair<int, bool> insert(int key) { return {key, tree.insert(key)}; }
+    size_t erase(int key) { return tree.erase(key); }
+    size_t size() const { return tree.size(); }
+    BinarySearchTree tree{BalanceMode::kAvl};
+  } avl;
+  std::set<int> set;
+  run("BinarySearchTree AVL", avl);
+  run("std::set", set);
+}
+
+TEST(TestBinarySearchTree, LookupBatch) {
+  // Preparations, 37 queries: two full groups and a partial one
+  BinarySearchTree bst(BalanceMode::kAvl);
+  for (int value = 0; value < 1000; value += 3) bst.insert(value);
+  std::vector<int> queries;
+  for (int value = -10; value < 1100; value += 30) queries.push_back(value);
+
+  // Operation
+  std::vector<BinarySearchTree::const_iterator> results(queries.size());
+  bst.lookup_batch(queries.data(), queries.size(), results.data());
+
+  // Tests
+  for (size_t i = 0; i < queries.size(); i++) {
+    auto node = bst.lookup(queries[i]);
+    EXPECT_EQ(results[i].node(), node.get()) << queries[i];
+    if (node) {
+      EXPECT_EQ(*results[i], queries[i]);
+    }
+  }
+  BinarySearchTree empty;
+  empty.lookup_batch(queries.data(), 3, results.data());
+  EXPECT_EQ(results[0], empty.end());
+  EXPECT_EQ(results[2], empty.end());
+}
+
+TEST(TestBinarySearchTree, LookupBatchStrings) {
+  BasicBinarySearchTree<std::string, int> map;
+  map.insert_or_assign("one", 1);
+  map.insert_or_assign("two", 2);
+  std::string queries[] = {"two", "three", "one"};
+  BasicBinarySearchTree<std::string, int>::const_iterator results[3];
+  map.lookup_batch(queries, 3, results);
+  EXPECT_EQ(results[0].node()->mapped, 2);
+  EXPECT_EQ(results[1], map.end());
+  EXPECT_EQ(results[2].node()->mapped, 1);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkLookupBatch) {
+  // About 90 bytes per node, 8M random inserts give a tree well over the
+  // last level cache.
+  const int N = 8000000;
+  const int kQueries = 4000000;
+  const size_t kBatch = 4096;
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+
+  std::vector<int> keys(N);
+  for (int i = 0; i < N; i++) keys[i] = 2 * i;
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+  BinarySearchTree bst;
+  for (int key : keys) bst.insert(key);
+  std::vector<int> queries(kQueries);
+  std::mt19937 random(2);
+  for (auto& query : queries) query = static_cast<int>(random() % (2 * N));
+
+  auto report = [&](const char* name, std::function<size_t()> run) {
+    auto start = Clock::now();
+    size_t found = run();
+    std::cout << N << " keys, " << name << ": "
+              << kQueries / seconds(Clock::now() - start) / 1e6
+              << " M lookups/s (found " << found << ")" << std::endl;
+  };
+  report("lookup loop", [&] {
+    size_t found = 0;
+    for (int query : queries) found += bst.lookup(query) != nullptr;
+    return found;
+  });
+  // no reference count, the same single chain of misses
+  report("lower_bound loop", [&] {
+    size_t found = 0;
+    for (int query : queries) {
+      auto it = bst.lower_bound(query);
+      found += it != bst.end() && *it == query;
+    }
+    return found;
+  });
+  report("lookup_batch", [&] {
+    size_t found = 0;
+    std::vector<BinarySearchTree::const_iterator> results(kBatch);
+    for (size_t first = 0; first < queries.size(); first += kBatch) {
+      size_t count = std::min(kBatch, queries.size() - first);
+      bst.lookup_batch(queries.data() + first, count, results.data());
+      for (size_t i = 0; i < count; i++) found += results[i] != bst.end();
+    }
+    return found;
+  });
+}
+
+// Checks the stored subtree sizes, returns the size.
+static size_t check_sizes(const BNodeSharedPtr& node) {
+  if (!node) return 0;
+  size_t size = 1 + check_sizes(node->left) + check_sizes(node->right);
+  EXPECT_EQ(node->size, size) << "at " << node->value;
+  return size;
+}
+
+TEST(TestBinarySearchTree, OrderStatistics) {
+  // Preparations
+  BinarySearchTree bst = create_tree();
+
+  // Tests
+  EXPECT_EQ(check_sizes(bst.root()), 7);
+  std::vector<int> selected;
+  for (size_t k = 0; k < 7; k++) selected.push_back(*bst.select(k));
+  EXPECT_THAT(selected, ElementsAre(0, 1, 2, 5, 7, 9, 10));
+  EXPECT_EQ(bst.select(7), bst.end());
+  EXPECT_EQ(bst.rank(-1), 0);
+  EXPECT_EQ(bst.rank(5), 3);
+  EXPECT_EQ(bst.rank(6), 4);
+  EXPECT_EQ(bst.rank(11), 7);
+  EXPECT_EQ(bst.count_range(1, 9), 4);
+  EXPECT_EQ(bst.count_range(3, 4), 0);
+  EXPECT_EQ(bst.count_range(9, 1), 0);
+  EXPECT_EQ(BinarySearchTree().select(0), BinarySearchTree().end());
+}
+
+TEST(TestBinarySearchTree, OrderStatisticsTransparent) {
+  BasicBinarySearchTree<std::string, int, std::less<>> map;
+  for (auto key : {"b", "d", "a", "c"}) map.insert_or_assign(key, 0);
+  EXPECT_EQ(map.rank(std::string_view("c")), 2);
+  EXPECT_EQ(map.count_range(std::string_view("b"), std::string_view("z")), 3);
+  EXPECT_EQ(*map.select(3), "d");
+}
+
+TEST(TestBinarySearchTree, OrderStatisticsUnderChurn) {
+  // Preparations
+  BinarySearchTree avl(BalanceMode::kAvl);
+  BinarySearchTree plain;
+  std::set<int> expected;
+  std::mt19937 random(5);
+
+  // Operation, sizes go through inserts, rotations, erases and relinking
+  for (int i = 0; i < 4000; i++) {
+    int value = static_cast<int>(random() % 1000);
+    if (random() % 3) {
+      avl.insert(value);
+      plain.insert(value);
+      expected.insert(value);
+    } else {
+      avl.erase(value);
+      plain.erase(value);
+      expected.erase(value);
+    }
+  }
+  std::vector<int> batch{1001, 1003, 1005};
+  avl.bulk_insert(batch.begin(), batch.end());
+  plain.erase(plain.lower_bound(900), plain.end());
+  expected.insert(batch.begin(), batch.end());
+
+  // Tests
+  EXPECT_EQ(check_sizes(avl.root()), expected.size());
+  check_sizes(plain.root());
+  size_t k = 0;
+  for (int value : expected) {
+    ASSERT_EQ(*avl.select(k), value);
+    EXPECT_EQ(avl.rank(value), k);
+    if (value < 900) {
+      EXPECT_EQ(*plain.select(k), value);
+    }
+    k++;
+  }
+  auto distance = [&](int first, int last) {
+    return static_cast<size_t>(std::distance(expected.lower_bound(first),
+                                             expected.lower_bound(last)));
+  };
+  EXPECT_EQ(avl.count_range(100, 700), distance(100, 700));
+  EXPECT_EQ(plain.count_range(0, 2000), distance(0, 900));
+}
+
+// Links of every node with a key above threshold, to see what was relinked.
+static std::map<int, std::vector<const BNode*>> links_above(
+    const BinarySearchTree& bst, int threshold) {
+  std::map<int, std::vector<const BNode*>> links;
+  for (auto it = bst.lower_bound(threshold + 1); it != bst.end(); ++it) {
+    const BNode* node = it.node();
+    links[*it] = {node, node->left.get(), node->right.get(), node->parent};
+  }
+  return links;
+}
+
+TEST(TestBinarySearchTree, EraseRangeTouchesOneSubtree) {
+  // Preparations, perfectly balanced, [0, 1023) is the subtree below
+  // 1023's left child, [0, 2047) the one below the root's.
+  std::vector<int> keys(4095);
+  std::iota(keys.begin(), keys.end(), 0);
+  auto plain = BinarySearchTree::from_sorted(keys.begin(), keys.end());
+  auto avl = BinarySearchTree::from_sorted(keys.begin(), keys.end(),
+                                           BalanceMode::kAvl);
+  auto plain_links = links_above(plain, 1023);
+  auto avl_links = links_above(avl, 2047);
+
+  // Operation, one large range
+  plain.erase(plain.lower_bound(100), plain.lower_bound(900));
+  avl.erase(avl.lower_bound(100), avl.lower_bound(900));
+
+  // Tests, only the subtree holding the range was relinked, not the tree
+  EXPECT_EQ(links_above(plain, 1023), plain_links);
+  EXPECT_EQ(links_above(avl, 2047), avl_links);
+  for (auto* bst : {&plain, &avl}) {
+    EXPECT_EQ(bst->size(), 4095 - 800);
+    EXPECT_EQ(check_sizes(bst->root()), 4095 - 800);
+    EXPECT_EQ(bst->rank(900), 100);
+    EXPECT_EQ(*bst->select(99), 99);
+    EXPECT_EQ(*bst->select(100), 900);
+  }
+  check_avl(avl.root(), -1, 4095);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestBinarySearchTree, DISABLED_BenchmarkPercentile) {
+  const int N = 10000000;
+  const int kQueries = 1000000;
+  const int kWalks = 20;
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+
+  std::vector<int> keys(N);
+  for (int i = 0; i < N; i++) keys[i] = 3 * i;
+  auto bst = BinarySearchTree::from_sorted(keys.begin(), keys.end(),
+                                           BalanceMode::kAvl);
+  std::mt19937 random(4);
+  std::vector<size_t> ranks(kQueries);
+  for (auto& rank : ranks) rank = random() % N;
+
+  // the old way, an in order walk to the k-th key
+  auto start = Clock::now();
+  long long sum = 0;
+  for (int i = 0; i < kWalks; i++) sum += *std::next(bst.begin(), ranks[i]);
+  double walk = seconds(Clock::now() - start) / kWalks;
+
+  start = Clock::now();
+  for (size_t rank : ranks) sum += *bst.select(rank);
+  double select = seconds(Clock::now() - start) / kQueries;
+
+  start = Clock::now();
+  for (size_t rank : ranks) sum += bst.rank(static_cast<int>(rank) * 3 + 1);
+  double rank = seconds(Clock::now() - start) / kQueries;
+
+  std::cout << N << " keys, per query: in order walk " << walk * 1e3
+            << " ms, select " << select * 1e9 << " ns, rank " << rank * 1e9
+            << " ns (sum " << sum << ")" << std::endl;
+  std::cout << "p50 " << *bst.select(N / 2) << ", p99 "
+            << *bst.select(N / 100 * 99) << ", p99.9 "
+            << *bst.select(N / 1000 * 999) << std::endl;
+}
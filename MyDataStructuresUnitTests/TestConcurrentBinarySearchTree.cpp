@@ -0,0 +1,254 @@
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "BinarySearcTree.h"
+#include "ConcurrentBinarySearchTree.h"
+#include "gmock\gmock.h"
+
+TEST(TestConcurrentBinarySearchTree, InsertLookup) {
+  // Preparations
+  ConcurrentBinarySearchTree<int> tree{5, 1, 9, 0, 2, 10, 7};
+
+  // Operation
+  EXPECT_TRUE(tree.insert(11));
+  EXPECT_FALSE(tree.insert(0));
+
+  // Tests
+  EXPECT_EQ(tree.size(), 8);
+  EXPECT_EQ(*tree.lookup(7), 7);
+  EXPECT_EQ(tree.lookup(8), nullptr);
+  EXPECT_TRUE(tree.contains(11));
+  EXPECT_FALSE(ConcurrentBinarySearchTree<int>().contains(0));
+}
+
+TEST(TestConcurrentBinarySearchTree, ConcurrentInserts) {
+  // Preparations, the threads insert overlapping key ranges
+  const int kThreads = 4;
+  const int kKeys = 20000;
+  ConcurrentBinarySearchTree<int> tree;
+  std::atomic<int> inserted{0};
+
+  // Operation
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      std::vector<int> keys(kKeys);
+      for (int i = 0; i < kKeys; i++) keys[i] = i + t * kKeys / 2;
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(t));
+      for (int key : keys) inserted += tree.insert(key);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // Tests, every key went in exactly once
+  const int kDistinct = kKeys + (kThreads - 1) * kKeys / 2;
+  EXPECT_EQ(inserted, kDistinct);
+  EXPECT_EQ(tree.size(), kDistinct);
+  for (int key = 0; key < kDistinct; key++) {
+    ASSERT_TRUE(tree.contains(key)) << key;
+  }
+  EXPECT_FALSE(tree.contains(kDistinct));
+}
+
+TEST(TestConcurrentBinarySearchTree, ReadersDuringInserts) {
+  // Readers must see every key inserted before they started.
+  ConcurrentBinarySearchTree<int> tree;
+  for (int key = 0; key < 10000; key += 2) tree.insert(key * 7 % 10000);
+  std::atomic<bool> done{false};
+  std::atomic<int> missing{0};
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        for (int key = 0; key < 10000; key += 2) {
+          if (!tree.contains(key * 7 % 10000)) missing++;
+        }
+      }
+    });
+  }
+  for (int key = 1; key < 10000; key += 2) tree.insert(key * 7 % 10000);
+  done = true;
+  for (auto& reader : readers) reader.join();
+
+  EXPECT_EQ(missing, 0);
+  EXPECT_EQ(tree.size(), 10000);
+}
+
+// Counts the comparisons of every tree using it.
+struct CountingLess {
+  bool operator()(int lhs, int rhs) const {
+    calls++;
+    return lhs < rhs;
+  }
+  static std::atomic<long long> calls;
+};
+std::atomic<long long> CountingLess::calls{0};
+
+TEST(TestConcurrentBinarySearchTree, SortedIdsStayLogarithmic) {
+  // Preparations, increasing ids from several threads
+  const int kThreads = 4;
+  const int kKeys = 1 << 16;
+  ConcurrentBinarySearchTree<int, CountingLess> tree;
+  std::atomic<int> next_id{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&] {
+      for (int id = next_id++; id < kKeys; id = next_id++) tree.insert(id);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // Operation
+  CountingLess::calls = 0;
+  for (int key = 0; key < kKeys; key += 64) {
+    ASSERT_TRUE(tree.contains(key)) << key;
+  }
+
+  // Tests, a list would need kKeys / 2 comparisons per lookup on average,
+  // the skip list about 2 log2(kKeys) = 32.
+  double per_lookup = double(CountingLess::calls) / (kKeys / 64);
+  EXPECT_LT(per_lookup, 100);
+  EXPECT_EQ(tree.size(), kKeys);
+  EXPECT_FALSE(tree.contains(kKeys));
+}
+
+// Every thread runs random lookups and inserts for a fixed time. With
+// next_id the inserts take increasing ids from it, like a sequence of ids,
+// and the lookups ask for ids below it.
+static long long RunMixedBenchmark(int threads, int insert_percent,
+                                   std::function<void(int)> insert,
+                                   std::function<bool(int)> lookup,
+                                   std::atomic<int>* next_id = nullptr) {
+  std::atomic<bool> done{false};
+  std::atomic<long long> operations{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::mt19937 random(t + 100);
+      long long local = 0;
+      while (!done) {
+        bool is_insert = static_cast<int>(random() % 100) < insert_percent;
+        int key = static_cast<int>(random() % 4000000);
+        if (next_id && is_insert) {
+          key = (*next_id)++;
+        } else if (next_id) {
+          key = static_cast<int>(random() % static_cast<unsigned>(*next_id));
+        }
+        if (is_insert) {
+          insert(key);
+        } else {
+          lookup(key);
+        }
+        local++;
+      }
+      operations += local;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  done = true;
+  for (auto& worker : workers) worker.join();
+  return operations;
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestConcurrentBinarySearchTree, DISABLED_BenchmarkReadWriteScaling) {
+  const int kPreload = 1000000;
+  int max_threads = std::max(2u, std::thread::hardware_concurrency());
+  std::vector<int> keys(kPreload);
+  std::mt19937 random(1);
+  for (auto& key : keys) key = static_cast<int>(random() % 4000000);
+
+  for (int insert_percent : {5, 50}) {
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      ConcurrentBinarySearchTree<int> concurrent;
+      for (int key : keys) concurrent.insert(key);
+      auto lock_free = RunMixedBenchmark(
+          threads, insert_percent, [&](int key) { concurrent.insert(key); },
+          [&](int key) { return concurrent.contains(key); });
+
+      BinarySearchTree locked_tree(BalanceMode::kAvl);
+      for (int key : keys) locked_tree.insert(key);
+      std::mutex mutex;
+      auto locked = RunMixedBenchmark(
+          threads, insert_percent,
+          [&](int key) {
+            std::lock_guard<std::mutex> lock(mutex);
+            locked_tree.insert(key);
+          },
+          [&](int key) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return locked_tree.lookup(key) != nullptr;
+          });
+
+      BinarySearchTree shared_tree(BalanceMode::kAvl);
+      for (int key : keys) shared_tree.insert(key);
+      std::shared_mutex shared_mutex;
+      auto shared = RunMixedBenchmark(
+          threads, insert_percent,
+          [&](int key) {
+            std::unique_lock<std::shared_mutex> lock(shared_mutex);
+            shared_tree.insert(key);
+          },
+          [&](int key) {
+            std::shared_lock<std::shared_mutex> lock(shared_mutex);
+            return shared_tree.lookup(key) != nullptr;
+          });
+
+      std::cout << 100 - insert_percent << "/" << insert_percent << " "
+                << threads << " threads, ops in 500 ms: lock-free "
+                << lock_free << ", mutex + AVL " << locked
+                << ", shared_mutex + AVL " << shared << std::endl;
+    }
+  }
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestConcurrentBinarySearchTree, DISABLED_BenchmarkSortedIds) {
+  // Increasing ids, the common case: both stay O(log n) deep.
+  const int kPreload = 10000;
+  int max_threads = std::max(2u, std::thread::hardware_concurrency());
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    ConcurrentBinarySearchTree<int> concurrent;
+    BinarySearchTree locked_tree(BalanceMode::kAvl);
+    for (int key = 0; key < kPreload; key++) {
+      concurrent.insert(key);
+      locked_tree.insert(key);
+    }
+    std::atomic<int> next_id{kPreload};
+    auto lock_free = RunMixedBenchmark(
+        threads, 5, [&](int key) { concurrent.insert(key); },
+        [&](int key) { return concurrent.contains(key); }, &next_id);
+
+    std::shared_mutex shared_mutex;
+    next_id = kPreload;
+    auto shared = RunMixedBenchmark(
+        threads, 5,
+        [&](int key) {
+          std::unique_lock<std::shared_mutex> lock(shared_mutex);
+          locked_tree.insert(key);
+        },
+        [&](int key) {
+          std::shared_lock<std::shared_mutex> lock(shared_mutex);
+          return locked_tree.lookup(key) != nullptr;
+        },
+        &next_id);
+
+    std::cout << "sorted ids, 95/5 " << threads
+              << " threads, ops in 500 ms: lock-free " << lock_free
+              << " (size " << concurrent.size() << "), shared_mutex + AVL "
+              << shared << " (size " << locked_tree.size() << ")"
+              << std::endl;
+  }
+}
@@ -0,0 +1,187 @@
+﻿#include "pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ConcurrentQueue.h"
+#include "LinkedList.h"
+#include "gmock\gmock.h"
+
+TEST(TestConcurrentQueue, PushPop) {
+  // Preparations
+  ConcurrentQueue<int> queue;
+  EXPECT_TRUE(queue.empty());
+
+  // Operation
+  queue.push(1);
+  queue.push(2);
+  queue.emplace(3);
+
+  // Tests, first in first out
+  int value = 0;
+  EXPECT_FALSE(queue.empty());
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 1);
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_TRUE(queue.pop(value));
+  EXPECT_EQ(value, 3);
+  EXPECT_FALSE(queue.pop(value));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(TestConcurrentQueue, MultipleProducersConsumers) {
+  // Preparations
+  const int kThreads = 4;
+  const int kPerProducer = 20000;
+  ConcurrentQueue<int> queue;
+  std::atomic<long long> sum{0};
+  std::atomic<int> popped{0};
+
+  // Operation
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&queue, t] {
+      for (int i = 0; i < kPerProducer; i++) {
+        queue.push(t * kPerProducer + i);
+      }
+    });
+    threads.emplace_back([&] {
+      int value;
+      while (popped.load() < kThreads * kPerProducer) {
+        if (queue.pop(value)) {
+          sum += value;
+          popped++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // Tests, every value is popped exactly once.
+  long long n = kThreads * kPerProducer;
+  EXPECT_EQ(popped.load(), n);
+  EXPECT_EQ(sum.load(), n * (n - 1) / 2);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(TestConcurrentQueue, ShortLivedThreads) {
+  // Preparations, every worker exits with fewer retired nodes than the scan
+  // threshold, so they are left behind as orphans for the next scan.
+  const int kRounds = 50;
+  const int kThreads = 4;
+  const int kPerThread = 100;
+  ConcurrentQueue<int> queue;
+  std::atomic<long long> sum{0};
+  std::atomic<int> popped{0};
+
+  // Operation
+  for (int round = 0; round < kRounds; round++) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < kPerThread; i++) queue.push(i);
+        int value;
+        for (int i = 0; i < kPerThread; i++) {
+          if (queue.pop(value)) {
+            sum += value;
+            popped++;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  int value;
+  while (queue.pop(value)) {
+    sum += value;
+    popped++;
+  }
+
+  // Tests, every value is popped exactly once.
+  long long n = kRounds * kThreads;
+  EXPECT_EQ(popped.load(), n * kPerThread);
+  EXPECT_EQ(sum.load(), n * kPerThread * (kPerThread - 1) / 2);
+  EXPECT_TRUE(queue.empty());
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+1..N producers and consumers, against LinkedList and std::list behind a mutex.
+*/
+namespace {
+template <class Push, class Pop>
+long long RunQueueBenchmark(int threads, int per_producer, Push push, Pop pop) {
+  using Clock = std::chrono::steady_clock;
+  std::atomic<int> popped{0};
+  int total = threads * per_producer;
+
+  auto start = Clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&] {
+      for (int i = 0; i < per_producer; i++) push(i);
+    });
+    workers.emplace_back([&] {
+      while (popped.load() < total) {
+        if (pop()) popped++;
+      }
+    });
+  }
+  for (auto& worker : workers) worker.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+}  // namespace
+
+TEST(TestConcurrentQueue, DISABLED_BenchmarkThroughput) {
+  const int kPerProducer = 200000;
+  int max_threads = std::max(2u, std::thread::hardware_concurrency() / 2);
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    ConcurrentQueue<int> queue;
+    auto lock_free = RunQueueBenchmark(
+        threads, kPerProducer, [&](int value) { queue.push(value); },
+        [&] {
+          int value;
+          return queue.pop(value);
+        });
+
+    std::mutex mutex;
+    LinkedList list;
+    auto linked = RunQueueBenchmark(
+        threads, kPerProducer,
+        [&](int value) {
+          std::lock_guard<std::mutex> lock(mutex);
+          list.push_back(value);
+        },
+        [&] {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (list.empty()) return false;
+          list.pop_front();
+          return true;
+        });
+
+    std::list<int> std_list;
+    auto std_linked = RunQueueBenchmark(
+        threads, kPerProducer,
+        [&](int value) {
+          std::lock_guard<std::mutex> lock(mutex);
+          std_list.push_back(value);
+        },
+        [&] {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (std_list.empty()) return false;
+          std_list.pop_front();
+          return true;
+        });
+
+    std::cout << threads << " producers/consumers: ConcurrentQueue "
+              << lock_free << " ms, LinkedList+mutex " << linked
+              << " ms, std::list+mutex " << std_linked << " ms" << std::endl;
+  }
+}
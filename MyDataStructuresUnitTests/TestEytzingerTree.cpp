@@ -0,0 +1,154 @@
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+#include "BinarySearcTree.h"
+#include "EytzingerTree.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+
+TEST(TestEytzingerTree, Layout) {
+  // Preparations
+  std::vector<int> sorted{0, 1, 2, 3, 4, 5, 6};
+
+  // Operation
+  EytzingerTree tree(sorted);
+
+  // Tests
+  std::vector<int> keys(tree.data() + 1, tree.data() + 8);
+  ASSERT_THAT(keys, ElementsAre(3, 1, 5, 0, 2, 4, 6));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(tree.data()) % 64, 0);
+  EXPECT_EQ(tree.size(), 7);
+}
+
+TEST(TestEytzingerTree, LowerBoundAllSizes) {
+  // Complete and partial last levels, even keys only.
+  for (int n = 0; n < 70; n++) {
+    std::vector<int> sorted(n);
+    for (int i = 0; i < n; i++) sorted[i] = 2 * i;
+    EytzingerTree tree(sorted);
+
+    for (int x = -2; x <= 2 * n + 1; x++) {
+      auto expected = std::lower_bound(sorted.begin(), sorted.end(), x);
+      const int* found = tree.lower_bound(x);
+      if (expected == sorted.end()) {
+        EXPECT_EQ(found, nullptr) << "n " << n << " x " << x;
+      } else {
+        ASSERT_NE(found, nullptr) << "n " << n << " x " << x;
+        EXPECT_EQ(*found, *expected) << "n " << n << " x " << x;
+      }
+      EXPECT_EQ(tree.contains(x), x >= 0 && x < 2 * n && x % 2 == 0);
+    }
+  }
+}
+
+TEST(TestEytzingerTree, LookupBatch) {
+  // Preparations
+  std::vector<int> sorted(1000);
+  std::iota(sorted.begin(), sorted.end(), -500);
+  EytzingerTree tree(sorted);
+  std::vector<int> queries;
+  for (int x = -600; x < 600; x += 7) queries.push_back(x);
+  queries.push_back(std::numeric_limits<int>::min());
+  queries.push_back(std::numeric_limits<int>::max());
+
+  // Operation
+  std::vector<const int*> results(queries.size());
+  tree.lookup_batch(queries.data(), queries.size(), results.data());
+
+  // Tests
+  for (size_t i = 0; i < queries.size(); i++) {
+    EXPECT_EQ(results[i], tree.lookup(queries[i])) << queries[i];
+  }
+  EytzingerTree empty;
+  const int* none[5];
+  empty.lookup_batch(queries.data(), 5, none);
+  EXPECT_EQ(none[0], nullptr);
+  EXPECT_EQ(none[4], nullptr);
+}
+
+TEST(TestEytzingerTree, Freeze) {
+  // Preparations
+  BinarySearchTree bst{5, 1, 9, 0, 2, 10, 7};
+
+  // Operation
+  EytzingerTree frozen = bst.freeze();
+  bst.insert(4);
+
+  // Tests, the frozen copy does not see later inserts
+  EXPECT_EQ(frozen.size(), 7);
+  EXPECT_TRUE(frozen.contains(7));
+  EXPECT_FALSE(frozen.contains(4));
+  EXPECT_EQ(*frozen.lower_bound(3), 5);
+  EXPECT_EQ(*frozen.lookup(10), 10);
+  EXPECT_EQ(frozen.lower_bound(11), nullptr);
+  EXPECT_TRUE(BinarySearchTree().freeze().empty());
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestEytzingerTree, DISABLED_BenchmarkLookup) {
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+  const int kQueries = 2000000;
+
+  for (int n : {1000000, 10000000}) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = 2 * i;
+    std::vector<int> shuffled = keys;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+    std::vector<int> queries(kQueries);
+    std::mt19937 random(2);
+    for (auto& query : queries) query = static_cast<int>(random() % (2 * n));
+
+    BinarySearchTree bst;
+    for (int key : shuffled) bst.insert(key);
+    std::set<int> set(keys.begin(), keys.end());
+    EytzingerTree frozen = bst.freeze();
+
+    auto report = [&](const char* name, std::function<size_t()> run) {
+      auto start = Clock::now();
+      size_t found = run();
+      double mlps = kQueries / seconds(Clock::now() - start) / 1e6;
+      std::cout << n << " keys, " << name << ": " << mlps
+                << " M lookups/s (found " << found << ")" << std::endl;
+    };
+    report("BinarySearchTree", [&] {
+      size_t found = 0;
+      for (int query : queries) found += bst.lookup(query) != nullptr;
+      return found;
+    });
+    report("std::set", [&] {
+      size_t found = 0;
+      for (int query : queries) found += set.count(query);
+      return found;
+    });
+    report("std::lower_bound", [&] {
+      size_t found = 0;
+      for (int query : queries) {
+        found += std::binary_search(keys.begin(), keys.end(), query);
+      }
+      return found;
+    });
+    report("EytzingerTree", [&] {
+      size_t found = 0;
+      for (int query : queries) found += frozen.contains(query);
+      return found;
+    });
+    report("EytzingerTree batch", [&] {
+      std::vector<const int*> results(queries.size());
+      frozen.lookup_batch(queries.data(), queries.size(), results.data());
+      return queries.size() - std::count(results.begin(), results.end(),
+                                         nullptr);
+    });
+  }
+}
@@ -0,0 +1,124 @@
+﻿#include "pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+#include "IndexableSkipList.h"
+#include "LinkedList.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+
+TEST(TestIndexableSkipList, PushBack) {
+  // Preparations
+  IndexableSkipList<int> list;
+
+  // Operation
+  list.push_back(1);
+  list.push_back(2);
+  list.push_front(0);
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(0, 1, 2));
+  EXPECT_EQ(list.size(), 3);
+}
+
+TEST(TestIndexableSkipList, Insert) {
+  IndexableSkipList<int> list{0, 1, 3, 4};
+
+  // insert element into index 2
+  list.insert(2, 10);
+  ASSERT_THAT(list, ElementsAre(0, 1, 10, 3, 4));
+  EXPECT_EQ(list.at(2), 10);
+  EXPECT_EQ(list.at(4), 4);
+}
+
+TEST(TestIndexableSkipList, Erase) {
+  IndexableSkipList<int> list{10, 20, 30};
+
+  list.erase(1);  // by index
+  ASSERT_THAT(list, ElementsAre(10, 30));
+
+  list.erase(1);
+  list.erase(0);
+  EXPECT_TRUE(list.empty());
+}
+
+TEST(TestIndexableSkipList, RandomPositionalEdits) {
+  // Preparations, the same edits on a vector give the expected result.
+  std::mt19937 random(42);
+  IndexableSkipList<int> list;
+  std::vector<int> expected;
+
+  // Operation
+  for (int i = 0; i < 3000; i++) {
+    size_t index = random() % (expected.size() + 1);
+    if (!expected.empty() && random() % 3 == 0) {
+      index = index % expected.size();
+      list.erase(index);
+      expected.erase(expected.begin() + index);
+    } else {
+      list.insert(index, i);
+      expected.insert(expected.begin() + index, i);
+    }
+  }
+
+  // Tests
+  ASSERT_THAT(list, ElementsAreArray(expected));
+  for (size_t i = 0; i < expected.size(); i += 7) {
+    EXPECT_EQ(list.at(i), expected[i]);
+  }
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Random positional inserts, O(log n) in the skip list, O(n) in the lists.
+*/
+TEST(TestIndexableSkipList, DISABLED_BenchmarkRandomInsert) {
+  const int kInserts = 10000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  for (int n : {100000, 1000000, 10000000}) {
+    std::mt19937 random(1);
+    IndexableSkipList<int> skip_list;
+    LinkedList linked;
+    std::list<int> std_list;
+    for (int i = 0; i < n; i++) {
+      skip_list.push_back(i);
+      linked.push_back(i);
+      std_list.push_back(i);
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < kInserts; i++) {
+      skip_list.insert(random() % skip_list.size(), i);
+    }
+    auto skip = ms(Clock::now() - start);
+
+    // the lists are linear per insert, only a few inserts are timed.
+    const int kListInserts = 100;
+    start = Clock::now();
+    for (int i = 0; i < kListInserts; i++) {
+      linked.insert(random() % linked.size(), i);
+    }
+    auto linked_ms = ms(Clock::now() - start);
+
+    start = Clock::now();
+    for (int i = 0; i < kListInserts; i++) {
+      std_list.insert(std::next(std_list.begin(), random() % std_list.size()),
+                      i);
+    }
+    auto std_ms = ms(Clock::now() - start);
+
+    std::cout << n << " elements: IndexableSkipList " << kInserts
+              << " inserts " << skip << " ms, LinkedList " << kListInserts
+              << " inserts " << linked_ms << " ms, std::list "
+              << kListInserts << " inserts " << std_ms << " ms" << std::endl;
+  }
+}
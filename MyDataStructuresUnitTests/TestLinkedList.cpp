@@ -1,5 +1,18 @@
 ﻿#include "pch.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <forward_list>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include "LinkedList.h"
 #include "gmock\gmock.h"
 
@@ -10,51 +23,8 @@ Here our aim is to use exaclty the same test methods as in TestStdList.
 
 MATCHER(IsEven, "") { return (arg % 2) == 0; }
 
-// Matcher for LinkedList, similar to existing ElemntsAre
-MATCHER(ElementsAre, "") {
-  auto list = static_cast<LinkedList>(arg);
-  return list.empty();
-}
-
-// Matcher for LinkedList, similar to existing ElemntsAre
-MATCHER_P(ElementsAre, p0, "") {
-  auto list = static_cast<LinkedList>(arg);
-  return p0 == list.at(0);
-}
-
-// Matcher for LinkedList, similar to existing ElemntsAre
-MATCHER_P2(ElementsAre, p0, p1, "") {
-  auto list = static_cast<LinkedList>(arg);
-  auto a = list.empty();
-  bool res = p0 == list.at(0) && p1 == list.at(1);
-  return res;
-}
-
-// Matcher for LinkedList, similar to existing ElemntsAre
-MATCHER_P3(ElementsAre, p0, p1, p2, "") {
-  auto list = static_cast<LinkedList>(arg);
-  auto a = list.empty();
-  bool res = p0 == list.at(0) && p1 == list.at(1) && p2 == list.at(2);
-  return res;
-}
-
-MATCHER_P4(ElementsAre, p0, p1, p2, p3, "") {
-  auto list = static_cast<LinkedList>(arg);
-  auto a = list.empty();
-  bool res = p0 == list.at(0) && p1 == list.at(1) && p2 == list.at(2) &&
-             p3 == list.at(3);
-  return res;
-}
-
-// Matcher for LinkedList, similar to existing ElemntsAre
-MATCHER_P5(ElementsAre, p0, p1, p2, p3, p4, "") {
-  auto list = static_cast<LinkedList>(arg);
-  auto a = list.empty();
-  bool res = p0 == list.at(0) && p1 == list.at(1) && p2 == list.at(2) &&
-             p3 == list.at(3) && p4 == list.at(4);
-  // int value = *list.node_at(0);
-  return res;
-}
+// LinkedList is iterable, so the gmock container matchers walk it once.
+using testing::ElementsAre;
 
 TEST(TestLinkedList, PushBack) {
   /*
@@ -127,7 +97,10 @@ TEST(TestLinkedList, Next) {
   auto begin = list.begin();
   auto next = std::next(begin);
   auto val = *next;
-  EXPECT_EQ(next->value, 2);
+  EXPECT_EQ(val, 2);
+
+  // node level walk
+  EXPECT_EQ(std::next(list.head())->value, 2);
 }
 
 TEST(TestLinkedList, Insert) {
@@ -160,3 +133,1112 @@ TEST(TestLinkedList, Remove) {
   list.remove(20);  // by index
   ASSERT_THAT(list, ElementsAre(10, 30));
 }
+
+TEST(TestLinkedList, AssignOverLongList) {
+  // Preparations
+  LinkedList list;
+  for (int i = 0; i < 1000000; i++) list.push_back(i);
+  LinkedList copy = list;
+  LinkedList short_list{1, 2};
+
+  // Operation, each assignment drops a long chain of its own
+  list = short_list;
+  list.push_back(3);
+
+  // Tests, the copy does not see the changes of list
+  ASSERT_THAT(list, ElementsAre(1, 2, 3));
+  EXPECT_EQ(copy.size(), 1000000);
+  EXPECT_EQ(copy.front(), 0);
+  EXPECT_EQ(copy.back(), 999999);
+  EXPECT_EQ(std::distance(copy.begin(), copy.end()), 1000000);
+
+  copy = short_list;
+  copy = copy;
+  ASSERT_THAT(copy, ElementsAre(1, 2));
+  EXPECT_EQ(copy.size(), 2);
+}
+
+TEST(TestLinkedList, CopyIsDeep) {
+  // Preparations
+  LinkedList list{3, 1, 2};
+  LinkedList copy = list;
+  LinkedList assigned;
+  assigned = list;
+
+  // Operation, mutating one list leaves the others alone
+  list.push_back(4);
+  list.sort();
+  copy.pop_back();
+  assigned.reverse();
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(1, 2, 3, 4));
+  ASSERT_THAT(copy, ElementsAre(3, 1));
+  ASSERT_THAT(assigned, ElementsAre(2, 1, 3));
+  EXPECT_EQ(copy.tail()->value, 1);
+  EXPECT_NE(list.get_allocator(), copy.get_allocator());
+}
+
+TEST(TestLinkedList, Move) {
+  // Preparations
+  BasicLinkedList<std::unique_ptr<int>> list;
+  list.push_back(std::make_unique<int>(1));
+  list.push_back(std::make_unique<int>(2));
+  int* first = list.front().get();
+
+  // Operation, the nodes are taken over, nothing is copied
+  BasicLinkedList<std::unique_ptr<int>> moved(std::move(list));
+  BasicLinkedList<std::unique_ptr<int>> assigned;
+  assigned.push_back(std::make_unique<int>(3));
+  assigned = std::move(moved);
+
+  // Tests
+  EXPECT_TRUE(list.empty());
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(assigned.size(), 2);
+  EXPECT_EQ(assigned.front().get(), first);
+  EXPECT_EQ(*assigned.back(), 2);
+}
+
+TEST(TestLinkedList, PoolAllocation) {
+  // Preparations
+  LinkedList list;
+
+  // Operation
+  for (int i = 0; i < 2000; i++) list.push_back(i);
+
+  // Tests, the first node created the pool of the list
+  auto pool = list.get_allocator().pool();
+  // node and control block live in one pool block, 1024 blocks per chunk.
+  EXPECT_EQ(pool->live_blocks(), 2000);
+  EXPECT_EQ(pool->chunk_count(), 2);
+
+  // Freed nodes are recycled, no new chunk is needed.
+  for (int i = 0; i < 1000; i++) list.pop_front();
+  for (int i = 0; i < 1000; i++) list.push_front(i);
+  EXPECT_EQ(pool->live_blocks(), 2000);
+  EXPECT_EQ(pool->heap_allocations(), 2);
+}
+
+TEST(TestLinkedList, PoolOutlivesTransferredNodes) {
+  // Preparations
+  LinkedList list{1, 2};
+  LinkedList moved_from{7};
+
+  // Operation, the nodes of a dead list and of a moved-from one
+  {
+    LinkedList other{3, 4};
+    LinkedList single{5};
+    list.splice(list.cend(), other);
+    list.merge(single);
+  }
+  LinkedList moved(std::move(moved_from));
+  moved_from.push_back(8);
+  moved_from.push_back(9);
+  moved.splice(moved.cend(), moved_from, moved_from.cbegin());
+
+  // Tests, the pools of the other lists are still alive
+  ASSERT_THAT(list, ElementsAre(1, 2, 3, 4, 5));
+  ASSERT_THAT(moved, ElementsAre(7, 8));
+  ASSERT_THAT(moved_from, ElementsAre(9));
+  EXPECT_NE(moved.get_allocator(), moved_from.get_allocator());
+  list.clear();
+  moved.clear();
+}
+
+TEST(TestLinkedList, OverAlignedValues) {
+  // Preparations
+  struct alignas(64) CacheLine {
+    int value;
+  };
+  BasicLinkedList<CacheLine> list;
+
+  // Operation
+  for (int i = 0; i < 100; i++) list.push_back(CacheLine{i});
+
+  // Tests, every element is aligned and the nodes come from the pool
+  for (auto& element : list) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&element) % 64, 0);
+  }
+  EXPECT_EQ(list.back().value, 99);
+  EXPECT_EQ(list.get_allocator().pool()->live_blocks(), 100);
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Heap allocations per operation: nodes from std::allocator (one allocation
+per node, like make_shared) against the NodePool (one per 1024 nodes).
+push_back N elements, then N rounds of pop_front + push_back.
+*/
+namespace {
+size_t g_counted_allocations = 0;
+
+// std::allocator that counts its calls to allocate.
+template <class T>
+struct CountingAllocator {
+  using value_type = T;
+  CountingAllocator() = default;
+  template <class U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    g_counted_allocations++;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* ptr, size_t n) { std::allocator<T>().deallocate(ptr, n); }
+
+  template <class U>
+  bool operator==(const CountingAllocator<U>&) const {
+    return true;
+  }
+  template <class U>
+  bool operator!=(const CountingAllocator<U>&) const {
+    return false;
+  }
+};
+
+template <class List, class Allocations>
+void RunAllocationBenchmark(const char* name, int n, Allocations allocations) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  List list;
+  for (int i = 0; i < n; i++) list.push_back(i);
+  for (int i = 0; i < n; i++) {
+    list.pop_front();
+    list.push_back(i);
+  }
+  double per_op = double(allocations(list)) / (3.0 * n);
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                Clock::now() - start)
+                .count();
+  std::cout << name << ": " << per_op << " heap allocations per operation, "
+            << ms << " ms" << std::endl;
+}
+}  // namespace
+
+TEST(TestLinkedList, DISABLED_BenchmarkPoolAllocation) {
+  const int N = 1000000;
+
+  g_counted_allocations = 0;
+  RunAllocationBenchmark<BasicLinkedList<int, CountingAllocator<int>>>(
+      "LinkedList, node per allocation", N,
+      [](const BasicLinkedList<int, CountingAllocator<int>>&) {
+        return g_counted_allocations;
+      });
+  RunAllocationBenchmark<LinkedList>(
+      "LinkedList, NodePool", N, [](const LinkedList& list) {
+        return list.get_allocator().pool()->heap_allocations();
+      });
+  g_counted_allocations = 0;
+  RunAllocationBenchmark<std::list<int, CountingAllocator<int>>>(
+      "std::list", N, [](const std::list<int, CountingAllocator<int>>&) {
+        return g_counted_allocations;
+      });
+}
+
+TEST(TestLinkedList, Prev) {
+  LinkedList list{1, 2, 3};
+
+  // tail() is the last node, walk back from it.
+  auto last = list.tail();
+  auto prev = std::prev(last);
+  EXPECT_EQ(last->value, 3);
+  EXPECT_EQ(prev->value, 2);
+  EXPECT_EQ(std::prev(last, 2), list.head().get());
+  EXPECT_EQ(std::prev(last, 3), nullptr);
+
+  // The head is owned by the list, dropping it leaves no owner behind.
+  ListNode<int>* head = std::prev(last, 2);
+  EXPECT_EQ(head->value, 1);
+  list.pop_front();
+  EXPECT_EQ(std::prev(last, 2), nullptr);
+}
+
+TEST(TestLinkedList, EraseNode) {
+  LinkedList list{10, 20, 30, 40};
+
+  // Operation, erase with a known node instead of an index.
+  list.erase(list.node_at(2));
+  ASSERT_THAT(list, ElementsAre(10, 20, 40));
+
+  list.erase(list.tail());
+  list.erase(list.head());
+  ASSERT_THAT(list, ElementsAre(20));
+  EXPECT_EQ(list.head(), list.tail());
+}
+
+TEST(TestLinkedList, RemoveIf) {
+  LinkedList list{1, 2, 3, 4, 5};
+
+  list.remove_if([](int value) { return value % 2 == 1; });
+  ASSERT_THAT(list, ElementsAre(2, 4));
+  EXPECT_EQ(list.back(), 4);
+  EXPECT_EQ(std::prev(list.tail())->value, 2);
+
+  list.remove_if([](int) { return true; });
+  ASSERT_THAT(list, ElementsAre());
+}
+
+TEST(TestLinkedList, Reverse) {
+  LinkedList list{10, 12, 0, 4};
+
+  list.reverse();
+  ASSERT_THAT(list, ElementsAre(4, 0, 12, 10));
+
+  // prev links are reversed as well
+  EXPECT_EQ(list.back(), 10);
+  EXPECT_EQ(*std::prev(list.end(), 2), 12);
+  list.pop_back();
+  ASSERT_THAT(list, ElementsAre(4, 0, 12));
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Drain 1M elements from each end, both are O(1) per pop.
+*/
+TEST(TestLinkedList, DISABLED_BenchmarkDrain) {
+  const int N = 1000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i);
+  auto start = Clock::now();
+  while (!list.empty()) list.pop_back();
+  std::cout << "LinkedList pop_back: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+
+  for (int i = 0; i < N; i++) list.push_back(i);
+  start = Clock::now();
+  while (!list.empty()) list.pop_front();
+  std::cout << "LinkedList pop_front: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+}
+
+// Counts copies and moves, emplace must construct it without any of them.
+struct CopyCounter {
+  CopyCounter(int v, std::string n) : value(v), name(std::move(n)) {}
+  CopyCounter(const CopyCounter& rhs) : value(rhs.value), name(rhs.name) {
+    copies++;
+  }
+  CopyCounter(CopyCounter&& rhs)
+      : value(rhs.value), name(std::move(rhs.name)) {
+    moves++;
+  }
+
+  int value;
+  std::string name;
+  static int copies;
+  static int moves;
+};
+int CopyCounter::copies = 0;
+int CopyCounter::moves = 0;
+
+TEST(TestLinkedList, EmplaceBack) {
+  // Preparations
+  LinkedList list{1, 2, 3};
+  BasicLinkedList<CopyCounter> counters;
+  CopyCounter::copies = CopyCounter::moves = 0;
+
+  // Operation
+  list.emplace_back(4);
+  list.emplace_back(5);
+  counters.emplace_back(1, "one");
+  counters.emplace_back(2, "two");
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_EQ(counters.at(1).name, "two");
+  EXPECT_EQ(CopyCounter::copies, 0);
+  EXPECT_EQ(CopyCounter::moves, 0);
+}
+
+TEST(TestLinkedList, EmplaceFront) {
+  // Preparations
+  LinkedList list{1, 2, 3};
+  BasicLinkedList<CopyCounter> counters;
+  CopyCounter::copies = CopyCounter::moves = 0;
+
+  // Operation
+  list.emplace_front(4);
+  list.emplace_front(5);
+  counters.emplace_front(1, "one");
+  counters.emplace_front(2, "two");
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(5, 4, 1, 2, 3));
+  EXPECT_EQ(counters.at(0).name, "two");
+  EXPECT_EQ(CopyCounter::copies, 0);
+  EXPECT_EQ(CopyCounter::moves, 0);
+}
+
+TEST(TestLinkedList, Emplace) {
+  LinkedList list{1, 2, 3};
+
+  // Operations && Tests
+  auto node = list.emplace(0, 4);
+  ASSERT_THAT(list, ElementsAre(4, 1, 2, 3));
+  EXPECT_EQ(node->value, 4);
+
+  list.emplace(4, 5);
+  ASSERT_THAT(list, ElementsAre(4, 1, 2, 3, 5));
+
+  BasicLinkedList<CopyCounter> counters;
+  counters.emplace_back(1, "one");
+  counters.emplace_back(3, "three");
+  CopyCounter::copies = CopyCounter::moves = 0;
+  counters.emplace(1, 2, "two");
+  EXPECT_EQ(counters.at(1).name, "two");
+  EXPECT_EQ(CopyCounter::copies, 0);
+  EXPECT_EQ(CopyCounter::moves, 0);
+}
+
+TEST(TestLinkedList, EmplaceIntoEmptyList) {
+  // Preparations
+  LinkedList list;
+
+  // Operation, an index past the end appends
+  auto node = list.emplace(3, 7);
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(7));
+  EXPECT_EQ(node, list.head());
+  EXPECT_EQ(list.tail(), list.head());
+}
+
+TEST(TestLinkedList, MoveOnly) {
+  // Preparations
+  BasicLinkedList<std::unique_ptr<int>> list;
+
+  // Operation
+  list.push_back(std::make_unique<int>(1));
+  list.emplace_back(new int(2));
+  list.emplace_front(std::make_unique<int>(0));
+
+  // Tests
+  EXPECT_EQ(*list.at(0), 0);
+  EXPECT_EQ(*list.at(1), 1);
+  EXPECT_EQ(*list.at(2), 2);
+
+  std::unique_ptr<int> taken = std::move(list.at(1));
+  list.erase(1);
+  EXPECT_EQ(*taken, 1);
+  EXPECT_EQ(*list.at(1), 2);
+}
+
+TEST(TestLinkedList, Iterator) {
+  LinkedList list{1, 2, 3, 4};
+
+  // range-for and std algorithms, one pass each.
+  int sum = 0;
+  for (int value : list) sum += value;
+  EXPECT_EQ(sum, 10);
+  EXPECT_EQ(std::accumulate(list.begin(), list.end(), 0), 10);
+
+  auto it = std::find(list.begin(), list.end(), 3);
+  ASSERT_NE(it, list.end());
+  *it = 30;
+  ASSERT_THAT(list, ElementsAre(1, 2, 30, 4));
+  EXPECT_EQ(std::find(list.begin(), list.end(), 5), list.end());
+
+  // end() is one past the tail
+  EXPECT_EQ(std::distance(list.begin(), list.end()), 4);
+  EXPECT_EQ(*std::prev(list.end()), 4);
+}
+
+TEST(TestLinkedList, ReverseIterator) {
+  const LinkedList list{1, 2, 3};
+
+  std::vector<int> reversed(list.rbegin(), list.rend());
+  ASSERT_THAT(reversed, ElementsAre(3, 2, 1));
+}
+
+TEST(TestLinkedList, MixedIteratorComparison) {
+  LinkedList list{1, 2};
+  LinkedList empty;
+
+  // iterator against const_iterator, both ways
+  EXPECT_TRUE(empty.begin() == empty.cend());
+  EXPECT_TRUE(list.cbegin() != list.end());
+  EXPECT_TRUE(std::next(list.begin(), 2) == list.cend());
+  EXPECT_FALSE(list.begin() != list.cbegin());
+}
+
+TEST(TestLinkedList, EraseIterator) {
+  LinkedList list{10, 20, 30, 40};
+
+  auto it = list.erase(std::next(list.begin()));
+  EXPECT_EQ(*it, 30);
+  it = list.erase(std::next(it));
+  EXPECT_EQ(it, list.end());
+  ASSERT_THAT(list, ElementsAre(10, 30));
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Full scan through iterators against a scan through at(i).
+*/
+TEST(TestLinkedList, DISABLED_BenchmarkIteratorScan) {
+  const int N = 20000;
+  using Clock = std::chrono::steady_clock;
+  auto us = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  };
+
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i);
+
+  auto start = Clock::now();
+  long long sum = std::accumulate(list.begin(), list.end(), 0LL);
+  std::cout << "iterator scan: " << us(Clock::now() - start) << " us"
+            << std::endl;
+
+  start = Clock::now();
+  long long sum_at = 0;
+  for (int i = 0; i < N; i++) sum_at += list.at(i);
+  std::cout << "at(i) scan: " << us(Clock::now() - start) << " us"
+            << std::endl;
+  EXPECT_EQ(sum, sum_at);
+}
+
+TEST(TestLinkedList, Sort) {
+  LinkedList first{2, 7, 4};
+
+  // Preparations
+  first.sort();
+
+  // Test
+  ASSERT_THAT(first, ElementsAre(2, 4, 7));
+  EXPECT_EQ(first.back(), 7);
+
+  first.sort(std::greater<int>());
+  ASSERT_THAT(first, ElementsAre(7, 4, 2));
+  EXPECT_EQ(*std::prev(first.end()), 2);
+}
+
+TEST(TestLinkedList, SortParity) {
+  // Preparations, same values in both lists, many duplicates.
+  LinkedList list;
+  std::list<int> std_list;
+  for (int i = 0; i < 1000; i++) {
+    int value = (i * 7919) % 101;
+    list.push_back(value);
+    std_list.push_back(value);
+  }
+  auto pool = list.get_allocator().pool();
+  size_t heap_allocations = pool->heap_allocations();
+
+  // Operation
+  list.sort();
+  std_list.sort();
+
+  // Tests, sorted by relinking, no allocation.
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), std_list.begin(),
+                         std_list.end()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), std_list.rbegin(),
+                         std_list.rend()));
+  EXPECT_EQ(pool->heap_allocations(), heap_allocations);
+  EXPECT_EQ(pool->live_blocks(), 1000);
+}
+
+TEST(TestLinkedList, Merge) {
+  BasicLinkedList<double> first{3.1, 2.2, 2.9};
+  BasicLinkedList<double> second{3.7, 7.1, 1.4};
+
+  // Preparations
+  first.sort();
+  second.sort();
+
+  ASSERT_THAT(first, ElementsAre(2.2, 2.9, 3.1));
+  ASSERT_THAT(second, ElementsAre(1.4, 3.7, 7.1));
+
+  // Opertaions
+  first.merge(second);
+  // (second is now empty)
+
+  // Tests
+  EXPECT_TRUE(second.empty());
+  ASSERT_THAT(first, ElementsAre(1.4, 2.2, 2.9, 3.1, 3.7, 7.1));
+
+  second.push_back(2.1);
+  second.push_back(7);
+
+  first.merge(second, [](double value1, double value2) {
+    return int(value1) < int(value2);  // compare only integer part
+  });
+
+  // Tests
+  EXPECT_TRUE(second.empty());
+  ASSERT_THAT(first, ElementsAre(1.4, 2.2, 2.9, 2.1, 3.1, 3.7, 7.1, 7));
+  EXPECT_EQ(first.size(), 8);
+}
+
+TEST(TestLinkedList, ThrowingComparator) {
+  // Preparations, the comparator throws on its 100th call
+  LinkedList list;
+  LinkedList first;
+  LinkedList second;
+  for (int i = 0; i < 50; i++) list.push_back((i * 37) % 50);
+  for (int i = 0; i < 20; i++) first.push_back(2 * i);
+  for (int i = 0; i < 20; i++) second.push_back(2 * i + 1);
+  int calls = 0;
+  auto comp = [&calls](int lhs, int rhs) {
+    if (++calls == 100) throw std::runtime_error("compare");
+    return lhs < rhs;
+  };
+
+  // Operation
+  EXPECT_THROW(list.sort(comp), std::runtime_error);
+  calls = 70;
+  EXPECT_THROW(first.merge(second, comp), std::runtime_error);
+
+  // Tests, no node is lost and the links agree with size()
+  auto check = [](LinkedList& checked, size_t size, int sum) {
+    EXPECT_EQ(checked.size(), size);
+    EXPECT_EQ(static_cast<size_t>(std::distance(checked.begin(),
+                                                checked.end())),
+              size);
+    EXPECT_EQ(static_cast<size_t>(std::distance(checked.rbegin(),
+                                                checked.rend())),
+              size);
+    EXPECT_EQ(std::accumulate(checked.begin(), checked.end(), 0), sum);
+  };
+  check(list, 50, 49 * 50 / 2);
+  check(first, 40, 39 * 40 / 2);
+  check(second, 0, 0);
+  list.sort();
+  EXPECT_TRUE(std::is_sorted(list.begin(), list.end()));
+  EXPECT_EQ(list.back(), 49);
+}
+
+TEST(TestLinkedList, Splice) {
+  LinkedList list1{1, 2, 3};
+  LinkedList list2{4, 5, 6};
+
+  // Test 1
+  list1.splice(list1.begin(), list2);  // move entire list
+  ASSERT_THAT(list1, ElementsAre(4, 5, 6, 1, 2, 3));
+  ASSERT_THAT(list2, ElementsAre());
+
+  // Test 2: Transfer only the 0th element (4) of list2 to after list1 next
+  LinkedList list3{1, 2, 3};
+  LinkedList list4{4, 5, 6};
+  list3.splice(++list3.begin(), list4, list4.begin());
+  ASSERT_THAT(list3, ElementsAre(1, 4, 2, 3));
+  ASSERT_THAT(list4, ElementsAre(5, 6));
+
+  // Test 3: Transfer 1 and 2 elements (6,7) of list2 begin.
+  LinkedList list5{1, 2, 3, 4};
+  LinkedList list6{5, 6, 7, 8};
+  auto it_start = std::next(list6.begin(), 1);
+  auto it_stop = std::next(list6.begin(), 3);  // 3 element is not included.
+
+  list5.splice(list5.begin(), list6, it_start, it_stop);
+  ASSERT_THAT(list5, ElementsAre(6, 7, 1, 2, 3, 4));
+  ASSERT_THAT(list6, ElementsAre(5, 8));
+  EXPECT_EQ(list5.size(), 6);
+
+  // Test 4: an element spliced onto its own position stays there
+  LinkedList list7{1, 2, 3};
+  list7.splice(std::next(list7.begin()), list7, std::next(list7.begin()));
+  ASSERT_THAT(list7, ElementsAre(1, 2, 3));
+  list7.splice(std::next(list7.begin(), 2), list7, std::next(list7.begin()));
+  ASSERT_THAT(list7, ElementsAre(1, 2, 3));
+  list7.splice(list7.end(), list7, list7.begin(), list7.end());
+  ASSERT_THAT(list7, ElementsAre(1, 2, 3));
+  list7.splice(list7.begin(), list7, std::prev(list7.end()));
+  ASSERT_THAT(list7, ElementsAre(3, 1, 2));
+  EXPECT_EQ(list7.size(), 3);
+  EXPECT_EQ(list6.size(), 2);
+
+  // splice at the end
+  list5.splice(list5.end(), list6);
+  ASSERT_THAT(list5, ElementsAre(6, 7, 1, 2, 3, 4, 5, 8));
+  EXPECT_EQ(list5.back(), 8);
+}
+
+TEST(TestLinkedList, Unique) {
+  BasicLinkedList<double> list{1, 2.2, 3, 2.2};
+
+  // must be sorted beforehand.
+  list.sort();
+  list.unique();
+
+  ASSERT_THAT(list, ElementsAre(1, 2.2, 3));
+
+  LinkedList values{1, 1, 2, 2, 2};
+  values.unique();
+  ASSERT_THAT(values, ElementsAre(1, 2));
+  EXPECT_EQ(values.back(), 2);
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Sort 10M elements in place, against copy to std::vector + sort + rebuild and
+std::list::sort.
+*/
+TEST(TestLinkedList, DISABLED_BenchmarkSort) {
+  const int N = 10000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+  auto random = [](int i) { return int((i * 2654435761u) % 1000003); };
+
+  {
+    LinkedList list;
+    for (int i = 0; i < N; i++) list.push_back(random(i));
+    auto start = Clock::now();
+    list.sort();
+    std::cout << "LinkedList::sort: " << ms(Clock::now() - start) << " ms"
+              << std::endl;
+  }
+  {
+    LinkedList list;
+    for (int i = 0; i < N; i++) list.push_back(random(i));
+    auto start = Clock::now();
+    std::vector<int> values(list.begin(), list.end());
+    std::sort(values.begin(), values.end());
+    LinkedList rebuilt;
+    for (int value : values) rebuilt.push_back(value);
+    std::cout << "vector sort + rebuild: " << ms(Clock::now() - start) << " ms"
+              << std::endl;
+  }
+  {
+    std::list<int> list;
+    for (int i = 0; i < N; i++) list.push_back(random(i));
+    auto start = Clock::now();
+    list.sort();
+    std::cout << "std::list::sort: " << ms(Clock::now() - start) << " ms"
+              << std::endl;
+  }
+}
+
+TEST(TestLinkedList, AtWithFinger) {
+  // Preparations, same edits on a vector give the expected values.
+  LinkedList list{0, 1, 2, 3, 4, 5, 6, 7};
+  std::vector<int> expected{0, 1, 2, 3, 4, 5, 6, 7};
+
+  // Sequential and backward access go through the cached finger.
+  for (size_t i = 0; i < expected.size(); i++) EXPECT_EQ(list.at(i), i);
+  for (size_t i = expected.size(); i-- > 0;) EXPECT_EQ(list.at(i), i);
+
+  // Every kind of write keeps at() correct.
+  EXPECT_EQ(list.at(5), 5);
+  list.push_front(-1);
+  expected.insert(expected.begin(), -1);
+  EXPECT_EQ(list.at(5), expected[5]);
+  list.pop_front();
+  expected.erase(expected.begin());
+  EXPECT_EQ(list.at(5), expected[5]);
+  list.insert(3, 30);
+  expected.insert(expected.begin() + 3, 30);
+  EXPECT_EQ(list.at(5), expected[5]);
+  list.erase(4);
+  expected.erase(expected.begin() + 4);
+  EXPECT_EQ(list.at(5), expected[5]);
+  EXPECT_EQ(list.at(list.size() - 1), expected.back());
+  list.pop_back();
+  expected.pop_back();
+  list.reverse();
+  std::reverse(expected.begin(), expected.end());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(list.at(i), expected[i]);
+  }
+  list.sort();
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(list.at(2), expected[2]);
+  EXPECT_EQ(list.node_at(expected.size()), nullptr);
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Sequential at(0), at(1)... is O(n) in total with the finger.
+*/
+TEST(TestLinkedList, DISABLED_BenchmarkSequentialAt) {
+  const int N = 1000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i);
+
+  auto start = Clock::now();
+  long long sum = 0;
+  for (int i = 0; i < N; i++) sum += list.at(i);
+  std::cout << "sequential at(i) over " << N
+            << " elements: " << ms(Clock::now() - start) << " ms" << std::endl;
+
+  start = Clock::now();
+  long long sum_iterator = std::accumulate(list.begin(), list.end(), 0LL);
+  std::cout << "iterator scan: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+  EXPECT_EQ(sum, sum_iterator);
+}
+
+TEST(TestLinkedList, ParallelRemoveIf) {
+  // Preparations, long enough for several segments
+  const int N = 5 * LinkedList::kMinParallelSegment + 17;
+  LinkedList list;
+  std::vector<int> expected;
+  for (int i = 0; i < N; i++) {
+    list.push_back(i);
+    if (i % 3 != 0 && i < N - 5) expected.push_back(i);
+  }
+
+  // Operation
+  list.parallel_remove_if([N](int x) { return x % 3 == 0 || x >= N - 5; },
+                          4);
+
+  // Tests, forward and backward walks see the same elements
+  ASSERT_EQ(list.size(), expected.size());
+  EXPECT_TRUE(std::equal(list.begin(), list.end(), expected.begin()));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(), expected.rbegin()));
+  EXPECT_EQ(list.back(), expected.back());
+  EXPECT_EQ(list.at(1000), expected[1000]);
+  list.push_back(-1);
+  EXPECT_EQ(list.back(), -1);
+}
+
+TEST(TestLinkedList, ParallelRemoveIfEdgeCases) {
+  LinkedList list{1, 2, 3, 4};
+  list.parallel_remove_if([](int x) { return x % 2 == 0; }, 8);
+  ASSERT_THAT(list, ElementsAre(1, 3));
+
+  // A whole segment is removed
+  const int N = 4 * LinkedList::kMinParallelSegment;
+  LinkedList large;
+  for (int i = 0; i < N; i++) large.push_back(i);
+  large.parallel_remove_if(
+      [](int x) {
+        return static_cast<size_t>(x) < LinkedList::kMinParallelSegment * 3;
+      },
+      4);
+  EXPECT_EQ(large.size(), LinkedList::kMinParallelSegment);
+  EXPECT_EQ(large.front(), LinkedList::kMinParallelSegment * 3);
+  EXPECT_EQ(*--large.end(), N - 1);
+
+  large.parallel_remove_if([](int) { return true; }, 4);
+  EXPECT_TRUE(large.empty());
+  large.parallel_remove_if([](int) { return true; });
+  large.push_front(1);
+  ASSERT_THAT(large, ElementsAre(1));
+}
+
+TEST(TestLinkedList, ParallelForEachAndReduce) {
+  // Preparations
+  const int N = 3 * LinkedList::kMinParallelSegment + 1;
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i);
+
+  // Operation
+  list.parallel_for_each([](int& x) { x *= 2; }, 3);
+  long long sum = list.parallel_reduce(
+      1LL, [](long long a, long long b) { return a + b; }, 3);
+
+  // Tests
+  EXPECT_EQ(list.at(N - 1), 2 * (N - 1));
+  EXPECT_EQ(sum, 1 + static_cast<long long>(N) * (N - 1));
+  EXPECT_EQ(LinkedList().parallel_reduce(5, std::plus<int>()), 5);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestLinkedList, DISABLED_BenchmarkParallel) {
+  const int N = 10000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    LinkedList list;
+    for (int i = 0; i < N; i++) list.push_back(i);
+
+    auto start = Clock::now();
+    list.parallel_for_each([](int& x) { x = x * 7 % 1000; }, threads);
+    auto for_each = ms(Clock::now() - start);
+
+    start = Clock::now();
+    volatile long long sum = list.parallel_reduce(
+        0LL, [](long long a, long long b) { return a + b; }, threads);
+    auto reduce = ms(Clock::now() - start);
+
+    start = Clock::now();
+    list.parallel_remove_if([](int x) { return x % 2 == 0; }, threads);
+    auto remove = ms(Clock::now() - start);
+
+    std::cout << threads << " threads over " << N
+              << " elements: for_each " << for_each << " ms, reduce " << reduce
+              << " ms, remove_if " << remove << " ms" << std::endl;
+    (void)sum;
+  }
+
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i * 7 % 1000);
+  auto start = Clock::now();
+  list.remove_if([](int x) { return x % 2 == 0; });
+  std::cout << "serial remove_if: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+}
+
+TEST(TestLinkedList, SaveLoad) {
+  // Preparations, more values than one write block
+  LinkedList list;
+  for (int i = 0; i < 10000; i++) list.push_back(i * 3);
+  std::stringstream stream;
+
+  // Operation
+  list.save(stream);
+  LinkedList loaded = LinkedList::load(stream);
+
+  // Tests
+  ASSERT_EQ(loaded.size(), list.size());
+  EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), list.begin()));
+  EXPECT_EQ(*--loaded.end(), 29997);
+  EXPECT_EQ(loaded.at(5000), 15000);
+  EXPECT_EQ(stream.str().size(), 16 + 10000 * sizeof(int));
+  // the nodes came out of chunks reserved up front
+  EXPECT_LE(loaded.get_allocator().pool()->chunk_count(), 10000 / 1024 + 2);
+}
+
+TEST(TestLinkedList, LoadFromMemory) {
+  std::stringstream stream;
+  LinkedList{1, 2, 3}.save(stream);
+  std::string bytes = stream.str();
+
+  auto list = LinkedList::load(bytes.data(), bytes.size());
+  ASSERT_THAT(list, ElementsAre(1, 2, 3));
+  list.push_front(0);
+  list.pop_back();
+  ASSERT_THAT(list, ElementsAre(0, 1, 2));
+
+  std::stringstream empty_stream;
+  LinkedList().save(empty_stream);
+  bytes = empty_stream.str();
+  EXPECT_TRUE(LinkedList::load(bytes.data(), bytes.size()).empty());
+  EXPECT_TRUE(LinkedList::load(empty_stream).empty());
+}
+
+TEST(TestLinkedList, LoadRejectsBadInput) {
+  std::stringstream stream;
+  LinkedList{1, 2, 3}.save(stream);
+  std::string bytes = stream.str();
+
+  std::string truncated = bytes.substr(0, bytes.size() - 1);
+  EXPECT_THROW(LinkedList::load(truncated.data(), truncated.size()),
+               std::runtime_error);
+  std::stringstream truncated_stream(truncated);
+  EXPECT_THROW(LinkedList::load(truncated_stream), std::runtime_error);
+  EXPECT_THROW(LinkedList::load(bytes.data(), 8), std::runtime_error);
+
+  std::string wrong_magic = "XXXX" + bytes.substr(4);
+  EXPECT_THROW(LinkedList::load(wrong_magic.data(), wrong_magic.size()),
+               std::runtime_error);
+  EXPECT_THROW(BasicLinkedList<long long>::load(bytes.data(), bytes.size()),
+               std::runtime_error);
+}
+
+TEST(TestLinkedList, LoadRejectsHugeCount) {
+  // Preparations, two blocks of values but a header claiming 10^12
+  LinkedList list;
+  for (int i = 0; i < 5000; i++) list.push_back(i);
+  std::stringstream stream;
+  list.save(stream);
+  std::string bytes = stream.str();
+  uint64_t count = 1000000000000ULL;
+  std::memcpy(&bytes[8], &count, sizeof(count));
+
+  // Tests, nothing is reserved for values that never come
+  std::stringstream huge_stream(bytes);
+  EXPECT_THROW(LinkedList::load(huge_stream), std::runtime_error);
+  EXPECT_THROW(LinkedList::load(bytes.data(), bytes.size()),
+               std::runtime_error);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestLinkedList, DISABLED_BenchmarkLoad) {
+  const int N = 10000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  LinkedList list;
+  for (int i = 0; i < N; i++) list.push_back(i);
+  std::stringstream text;
+  for (int value : list) text << value << ' ';
+  std::stringstream binary;
+  auto start = Clock::now();
+  list.save(binary);
+  std::cout << "save " << N << " elements: " << ms(Clock::now() - start)
+            << " ms" << std::endl;
+  std::string bytes = binary.str();
+
+  start = Clock::now();
+  {
+    LinkedList loaded;
+    int value;
+    while (text >> value) loaded.push_back(value);
+    EXPECT_EQ(loaded.size(), list.size());
+  }
+  std::cout << "text + push_back: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+
+  start = Clock::now();
+  {
+    LinkedList loaded;
+    binary.seekg(16);
+    int value;
+    while (binary.read(reinterpret_cast<char*>(&value), sizeof(value)))
+      loaded.push_back(value);
+    EXPECT_EQ(loaded.size(), list.size());
+  }
+  std::cout << "binary + push_back: " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+
+  start = Clock::now();
+  {
+    binary.clear();
+    binary.seekg(0);
+    auto loaded = LinkedList::load(binary);
+    EXPECT_EQ(loaded.size(), list.size());
+  }
+  std::cout << "load(stream): " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+
+  start = Clock::now();
+  {
+    auto loaded = LinkedList::load(bytes.data(), bytes.size());
+    EXPECT_EQ(loaded.size(), list.size());
+  }
+  std::cout << "load(memory): " << ms(Clock::now() - start) << " ms"
+            << std::endl;
+}
+
+TEST(TestLinkedList, RangeConstructor) {
+  // Preparations
+  std::vector<int> values{1, 2, 3, 4};
+  std::forward_list<int> forward{5, 6};
+  std::istringstream text("7 8 9");
+
+  // Operation
+  LinkedList from_vector(values.begin(), values.end());
+  LinkedList from_forward_list(forward.begin(), forward.end());
+  LinkedList from_stream{std::istream_iterator<int>(text),
+                         std::istream_iterator<int>()};
+  LinkedList from_empty(values.end(), values.end());
+
+  // Tests, prev links and tail are set too
+  ASSERT_THAT(from_vector, ElementsAre(1, 2, 3, 4));
+  EXPECT_TRUE(std::equal(from_vector.rbegin(), from_vector.rend(),
+                         values.rbegin()));
+  ASSERT_THAT(from_forward_list, ElementsAre(5, 6));
+  ASSERT_THAT(from_stream, ElementsAre(7, 8, 9));
+  EXPECT_EQ(from_stream.back(), 9);
+  EXPECT_TRUE(from_empty.empty());
+}
+
+TEST(TestLinkedList, AssignAndAppendRange) {
+  LinkedList list{1, 2, 3};
+  EXPECT_EQ(list.at(2), 3);
+  std::vector<int> values{7, 8};
+
+  list.assign(values.begin(), values.end());
+  ASSERT_THAT(list, ElementsAre(7, 8));
+  EXPECT_EQ(list.at(1), 8);
+  EXPECT_EQ(list.size(), 2);
+
+  list.append_range(values);
+  list.append_range(std::vector<int>());
+  ASSERT_THAT(list, ElementsAre(7, 8, 7, 8));
+  EXPECT_EQ(list.back(), 8);
+
+  list.assign(values.end(), values.end());
+  EXPECT_TRUE(list.empty());
+  list.append_range(std::list<int>{1, 2});
+  ASSERT_THAT(list, ElementsAre(1, 2));
+}
+
+TEST(TestLinkedList, InsertRange) {
+  // Preparations
+  LinkedList list{1, 5};
+  std::vector<int> values{2, 3, 4};
+
+  // Operation
+  auto it = list.insert(++list.cbegin(), values.begin(), values.end());
+  auto front = list.insert(list.cbegin(), values.begin(), values.begin() + 1);
+  auto back = list.insert(list.cend(), values.end() - 1, values.end());
+  auto none = list.insert(list.cend(), values.end(), values.end());
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(2, 1, 2, 3, 4, 5, 4));
+  EXPECT_TRUE(std::equal(list.rbegin(), list.rend(),
+                         std::vector<int>{4, 5, 4, 3, 2, 1, 2}.begin()));
+  EXPECT_EQ(*it, 2);
+  EXPECT_EQ(front, list.begin());
+  EXPECT_EQ(*back, 4);
+  EXPECT_EQ(none, list.end());
+  EXPECT_EQ(list.size(), 7);
+}
+
+struct ThrowingCopy {
+  ThrowingCopy(int v) : value(v) {}
+  ThrowingCopy(const ThrowingCopy& rhs) : value(rhs.value) {
+    if (value < 0) throw std::runtime_error("copy");
+  }
+  int value;
+};
+
+TEST(TestLinkedList, InsertRangeIsAllOrNothing) {
+  BasicLinkedList<ThrowingCopy> list{1, 2};
+  std::vector<ThrowingCopy> values;
+  values.reserve(3);
+  for (int value : {3, 4, -1}) values.emplace_back(value);
+
+  EXPECT_THROW(list.insert(list.cend(), values.begin(), values.end()),
+               std::runtime_error);
+  EXPECT_THROW(list.assign(values.begin(), values.end()), std::runtime_error);
+  ASSERT_EQ(list.size(), 2);
+  EXPECT_EQ(list.back().value, 2);
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestLinkedList, DISABLED_BenchmarkBulkBuild) {
+  const int N = 1000000;
+  const int kRounds = 10;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+  std::vector<int> values(N);
+  std::iota(values.begin(), values.end(), 0);
+
+  // Only the build is timed, the lists are destroyed outside the clock.
+  auto time_builds = [&](const char* name, std::function<void(LinkedList&)> f) {
+    Clock::duration total{};
+    for (int round = 0; round < kRounds; round++) {
+      LinkedList list;
+      auto start = Clock::now();
+      f(list);
+      total += Clock::now() - start;
+      EXPECT_EQ(list.size(), values.size());
+    }
+    std::cout << kRounds << " x " << N << " " << name << ": " << ms(total)
+              << " ms" << std::endl;
+  };
+
+  time_builds("push_back", [&](LinkedList& list) {
+    for (int value : values) list.push_back(value);
+  });
+  time_builds("assign", [&](LinkedList& list) {
+    list.assign(values.begin(), values.end());
+  });
+  time_builds("append_range", [&](LinkedList& list) {
+    list.append_range(values);
+  });
+}
@@ -0,0 +1,128 @@
+﻿#include "pch.h"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include "NodePool.h"
+#include "gmock\gmock.h"
+
+struct PoolItem {
+  int value;
+  void* next;
+};
+
+TEST(TestNodePool, Allocate) {
+  // Preparations
+  NodePool pool(4);
+
+  // Operation
+  std::vector<void*> blocks;
+  for (int i = 0; i < 8; i++) {
+    blocks.push_back(pool.allocate(sizeof(PoolItem), alignof(PoolItem)));
+  }
+
+  // Tests
+  // 8 blocks fit into 2 chunks of 4 blocks
+  EXPECT_EQ(pool.chunk_count(), 2);
+  EXPECT_EQ(pool.heap_allocations(), 2);
+  EXPECT_EQ(pool.live_blocks(), 8);
+
+  for (auto block : blocks) {
+    pool.deallocate(block, sizeof(PoolItem), alignof(PoolItem));
+  }
+  EXPECT_EQ(pool.live_blocks(), 0);
+}
+
+TEST(TestNodePool, RecycleFreedBlocks) {
+  // Preparations
+  NodePool pool(4);
+  void* first = pool.allocate(sizeof(PoolItem), alignof(PoolItem));
+
+  // Operation
+  pool.deallocate(first, sizeof(PoolItem), alignof(PoolItem));
+  void* second = pool.allocate(sizeof(PoolItem), alignof(PoolItem));
+
+  // Tests
+  // The freed block is on top of the free list, so it is handed out again.
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(pool.chunk_count(), 1);
+  pool.deallocate(second, sizeof(PoolItem), alignof(PoolItem));
+}
+
+TEST(TestNodePool, Reserve) {
+  NodePool pool(4);
+
+  // Operation
+  pool.reserve(10, sizeof(PoolItem), alignof(PoolItem));
+  EXPECT_EQ(pool.chunk_count(), 1);  // one chunk of 10 blocks
+
+  std::vector<void*> blocks;
+  for (int i = 0; i < 10; i++) {
+    blocks.push_back(pool.allocate(sizeof(PoolItem), alignof(PoolItem)));
+  }
+
+  // Tests
+  // no further chunk was needed
+  EXPECT_EQ(pool.chunk_count(), 1);
+  pool.reserve(12, sizeof(PoolItem), alignof(PoolItem));
+  EXPECT_EQ(pool.chunk_count(), 2);
+  for (auto block : blocks) {
+    pool.deallocate(block, sizeof(PoolItem), alignof(PoolItem));
+  }
+}
+
+TEST(TestNodePool, ReserveOverflow) {
+  NodePool pool(4);
+  EXPECT_THROW(pool.reserve(std::numeric_limits<size_t>::max() / 4,
+                            sizeof(PoolItem), alignof(PoolItem)),
+               std::length_error);
+  EXPECT_EQ(pool.chunk_count(), 0);
+}
+
+TEST(TestNodePool, OverAligned) {
+  // Preparations
+  struct alignas(64) Wide {
+    char bytes[24];
+  };
+  NodePool pool(3);
+
+  // Operation, more than one chunk
+  std::vector<void*> blocks;
+  for (int i = 0; i < 8; i++) {
+    blocks.push_back(pool.allocate(sizeof(Wide), alignof(Wide)));
+  }
+  void* bigger = pool.allocate(2 * sizeof(Wide), 128);
+
+  // Tests, pooled blocks and the heap fallback keep the alignment
+  for (void* block : blocks) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % 64, 0);
+  }
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(bigger) % 128, 0);
+  EXPECT_EQ(pool.live_blocks(), 8);
+  EXPECT_EQ(pool.chunk_count(), 3);
+  pool.deallocate(bigger, 2 * sizeof(Wide), 128);
+  for (void* block : blocks) {
+    pool.deallocate(block, sizeof(Wide), alignof(Wide));
+  }
+}
+
+TEST(TestNodePool, AllocateShared) {
+  // Preparations
+  NodePool pool(16);
+  PoolAllocator<PoolItem> allocator(&pool);
+
+  // Operation
+  std::vector<std::shared_ptr<PoolItem>> items;
+  for (int i = 0; i < 32; i++) {
+    items.push_back(
+        std::allocate_shared<PoolItem>(allocator, PoolItem{i, nullptr}));
+  }
+
+  // Tests
+  // object and control block share one pool block
+  EXPECT_EQ(allocator.pool()->live_blocks(), 32);
+  EXPECT_EQ(allocator.pool()->chunk_count(), 2);
+
+  items.clear();
+  EXPECT_EQ(allocator.pool()->live_blocks(), 0);
+}
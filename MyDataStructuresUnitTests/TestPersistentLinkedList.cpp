@@ -0,0 +1,248 @@
+﻿#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include "LinkedList.h"
+#include "PersistentLinkedList.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+
+TEST(TestPersistentLinkedList, PushFrontPopFront) {
+  // Preparations
+  PersistentLinkedList<int> list{2, 3};
+
+  // Operation
+  list.push_front(1);
+
+  // Tests
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 2, 3));
+  EXPECT_EQ(list.size(), 3);
+
+  list.pop_front();
+  list.pop_front();
+  ASSERT_THAT(list.snapshot(), ElementsAre(3));
+  list.pop_front();
+  list.pop_front();
+  ASSERT_TRUE(list.empty());
+}
+
+TEST(TestPersistentLinkedList, RangeConstructor) {
+  // Preparations
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+
+  // Operation, O(n) instead of n push_backs
+  PersistentLinkedList<int> list(values.begin(), values.end());
+
+  // Tests
+  auto snapshot = list.snapshot();
+  EXPECT_EQ(list.size(), 1000);
+  EXPECT_TRUE(std::equal(snapshot.begin(), snapshot.end(), values.begin(),
+                         values.end()));
+}
+
+TEST(TestPersistentLinkedList, SnapshotIsUnchangedByWrites) {
+  // Preparations
+  PersistentLinkedList<int> list{0, 1, 3, 4};
+  auto before = list.snapshot();
+
+  // Operation
+  list.insert(2, 2);
+  list.push_back(5);
+  list.erase(0);
+  auto after = list.snapshot();
+  list.remove_if([](int value) { return value % 2 == 0; });
+
+  // Tests
+  ASSERT_THAT(before, ElementsAre(0, 1, 3, 4));
+  EXPECT_EQ(before.size(), 4);
+  ASSERT_THAT(after, ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_EQ(after.at(3), 4);
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 3, 5));
+  EXPECT_EQ(list.size(), 3);
+}
+
+TEST(TestPersistentLinkedList, WritesShareTheSuffix) {
+  // Preparations
+  PersistentLinkedList<int> list{0, 1, 3, 4};
+  auto before = list.snapshot();
+
+  // Operation
+  list.insert(2, 2);
+  auto after = list.snapshot();
+
+  // Tests, {0 1} are copied, {3 4} are the same nodes
+  EXPECT_NE(&*before.begin(), &*after.begin());
+  EXPECT_NE(&*std::next(before.begin()), &*std::next(after.begin()));
+  EXPECT_EQ(&*std::next(before.begin(), 2), &*std::next(after.begin(), 3));
+  EXPECT_EQ(&*std::next(before.begin(), 3), &*std::next(after.begin(), 4));
+}
+
+TEST(TestPersistentLinkedList, EraseAndRemove) {
+  PersistentLinkedList<int> list{1, 2, 3, 2};
+
+  list.erase(1);
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 3, 2));
+  list.erase(10);
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 3, 2));
+  list.remove(2);
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 3));
+  list.remove(7);
+  ASSERT_THAT(list.snapshot(), ElementsAre(1, 3));
+  EXPECT_EQ(list.at(1), 3);
+}
+
+TEST(TestPersistentLinkedList, ConcurrentReaders) {
+  // Preparations
+  const int kWrites = 20000;
+  PersistentLinkedList<int> list;
+  std::atomic<bool> done{false};
+  std::atomic<int> bad_snapshots{0};
+
+  // Operation, every snapshot must be a descending run n-1, ..., 0
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto snapshot = list.snapshot();
+        int expected = static_cast<int>(snapshot.size());
+        for (int value : snapshot) {
+          if (value != --expected) bad_snapshots++;
+        }
+        if (expected != 0) bad_snapshots++;
+      }
+    });
+  }
+  for (int i = 0; i < kWrites; i++) {
+    list.push_front(i);
+    if (i % 4 == 3) {
+      list.pop_front();
+      list.push_front(i);
+    }
+  }
+  done = true;
+  for (auto& reader : readers) reader.join();
+
+  // Tests
+  EXPECT_EQ(bad_snapshots, 0);
+  EXPECT_EQ(list.size(), kWrites);
+}
+
+TEST(TestPersistentLinkedList, DestroyLongList) {
+  PersistentLinkedList<int> list;
+  for (int i = 0; i < 1000000; i++) list.push_front(i);
+  auto snapshot = list.snapshot();
+  list.pop_front();
+  EXPECT_EQ(snapshot.size(), 1000000);
+}
+
+TEST(TestPersistentLinkedList, AssignOverLongSnapshot) {
+  // Preparations, the snapshot is the only owner of 1M nodes
+  PersistentLinkedList<int> list;
+  for (int i = 0; i < 1000000; i++) list.push_front(i);
+  auto snapshot = list.snapshot();
+  while (!list.empty()) list.pop_front();
+  list.push_front(7);
+
+  // Operation
+  snapshot = list.snapshot();
+
+  // Tests
+  EXPECT_THAT(snapshot, ElementsAre(7));
+  auto copy = snapshot;
+  copy = PersistentLinkedList<int>::Snapshot();
+  EXPECT_TRUE(copy.empty());
+  EXPECT_EQ(snapshot.size(), 1);
+}
+
+TEST(TestPersistentLinkedList, WritesReplacingLongPrefix) {
+  // Each write copies almost the whole list, the old copy is freed.
+  PersistentLinkedList<int> list;
+  for (int i = 0; i < 1000000; i++) list.push_front(i);
+
+  list.push_back(-1);
+  EXPECT_EQ(list.size(), 1000001);
+  list.erase(list.size() - 1);
+  EXPECT_EQ(list.size(), 1000000);
+  list.remove(0);
+  EXPECT_EQ(list.size(), 999999);
+  EXPECT_EQ(list.at(0), 999999);
+}
+
+// Readers summing the list while one writer keeps pushing and popping:
+// snapshots against a mutex guarded LinkedList.
+template <class Write, class Read>
+long long RunReaderBenchmark(int readers, Write write, Read read) {
+  std::atomic<bool> done{false};
+  std::atomic<long long> scans{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < readers; i++) {
+    threads.emplace_back([&] {
+      long long local = 0;
+      while (!done) {
+        read();
+        local++;
+      }
+      scans += local;
+    });
+  }
+  std::thread writer([&] {
+    for (int i = 0; !done; i++) write(i);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  done = true;
+  writer.join();
+  for (auto& thread : threads) thread.join();
+  return scans;
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests.
+TEST(TestPersistentLinkedList, DISABLED_BenchmarkReaderScaling) {
+  const int kLength = 10000;
+  int max_threads = std::max(2u, std::thread::hardware_concurrency() / 2);
+
+  for (int readers = 1; readers <= max_threads; readers *= 2) {
+    PersistentLinkedList<int> persistent;
+    for (int i = 0; i < kLength; i++) persistent.push_front(i);
+    auto snapshot_scans = RunReaderBenchmark(
+        readers,
+        [&](int i) {
+          persistent.pop_front();
+          persistent.push_front(i);
+        },
+        [&] {
+          auto snapshot = persistent.snapshot();
+          volatile long long sum =
+              std::accumulate(snapshot.begin(), snapshot.end(), 0LL);
+          (void)sum;
+        });
+
+    std::mutex mutex;
+    LinkedList list;
+    for (int i = 0; i < kLength; i++) list.push_front(i);
+    auto locked_scans = RunReaderBenchmark(
+        readers,
+        [&](int i) {
+          std::lock_guard<std::mutex> lock(mutex);
+          list.pop_front();
+          list.push_front(i);
+        },
+        [&] {
+          std::lock_guard<std::mutex> lock(mutex);
+          volatile long long sum =
+              std::accumulate(list.begin(), list.end(), 0LL);
+          (void)sum;
+        });
+
+    std::cout << readers << " readers, scans in 500 ms: snapshot "
+              << snapshot_scans << ", mutex + LinkedList " << locked_scans
+              << std::endl;
+  }
+}
@@ -0,0 +1,118 @@
+﻿#include "pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include "LinkedList.h"
+#include "UniqueLinkedList.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+
+TEST(TestUniqueLinkedList, PushBackPushFront) {
+  // Preparations
+  UniqueLinkedList<int> list;
+
+  // Operation
+  list.push_back(2);
+  list.push_back(3);
+  list.push_front(1);
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(1, 2, 3));
+  EXPECT_EQ(list.front(), 1);
+  EXPECT_EQ(list.back(), 3);
+}
+
+TEST(TestUniqueLinkedList, PopBackPopFront) {
+  UniqueLinkedList<int> list{1, 2, 3, 4};
+
+  list.pop_back();
+  list.pop_front();
+  ASSERT_THAT(list, ElementsAre(2, 3));
+
+  list.pop_back();
+  list.pop_back();
+  ASSERT_THAT(list, ElementsAre());
+  list.push_back(5);
+  ASSERT_THAT(list, ElementsAre(5));
+}
+
+TEST(TestUniqueLinkedList, InsertErase) {
+  UniqueLinkedList<int> list{0, 1, 3, 4};
+
+  list.insert(2, 10);
+  ASSERT_THAT(list, ElementsAre(0, 1, 10, 3, 4));
+  EXPECT_EQ(list.at(3), 3);
+
+  list.erase(1);
+  list.erase(3);
+  ASSERT_THAT(list, ElementsAre(0, 10, 3));
+  EXPECT_EQ(list.back(), 3);
+}
+
+TEST(TestUniqueLinkedList, RemoveIf) {
+  UniqueLinkedList<int> list{1, 2, 3, 4, 5};
+
+  list.remove_if([](int value) { return value % 2 == 1; });
+  ASSERT_THAT(list, ElementsAre(2, 4));
+  list.remove(4);
+  ASSERT_THAT(list, ElementsAre(2));
+  EXPECT_EQ(list.back(), 2);
+}
+
+TEST(TestUniqueLinkedList, Reverse) {
+  UniqueLinkedList<int> list{10, 12, 0, 4};
+
+  list.reverse();
+  ASSERT_THAT(list, ElementsAre(4, 0, 12, 10));
+  list.pop_back();
+  ASSERT_THAT(list, ElementsAre(4, 0, 12));
+  EXPECT_EQ(list.at(2), 12);
+}
+
+TEST(TestUniqueLinkedList, DestroyLongList) {
+  // A recursive teardown would overflow the stack long before this size.
+  UniqueLinkedList<int> list;
+  for (int i = 0; i < 1000000; i++) list.push_back(i);
+  EXPECT_EQ(list.size(), 1000000);
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Traversal and destruction against LinkedList.
+*/
+TEST(TestUniqueLinkedList, DISABLED_BenchmarkTraverseDestroy) {
+  const int N = 10000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+
+  {
+    auto list = new UniqueLinkedList<int>;
+    for (int i = 0; i < N; i++) list->push_back(i);
+    auto start = Clock::now();
+    long long sum = std::accumulate(list->begin(), list->end(), 0LL);
+    auto traverse = ms(Clock::now() - start);
+    start = Clock::now();
+    delete list;
+    std::cout << "UniqueLinkedList traverse " << traverse << " ms, destroy "
+              << ms(Clock::now() - start) << " ms (" << sum << ")"
+              << std::endl;
+  }
+  {
+    auto list = new LinkedList;
+    for (int i = 0; i < N; i++) list->push_back(i);
+    auto start = Clock::now();
+    // node level walk, every step copies a shared_ptr
+    long long sum = 0;
+    for (auto node = list->head(); node; node = node->next) sum += node->value;
+    auto traverse = ms(Clock::now() - start);
+    start = Clock::now();
+    delete list;
+    std::cout << "LinkedList traverse " << traverse << " ms, destroy "
+              << ms(Clock::now() - start) << " ms (" << sum << ")"
+              << std::endl;
+  }
+}
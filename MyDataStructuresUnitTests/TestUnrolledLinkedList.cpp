@@ -0,0 +1,217 @@
+﻿#include "pch.h"
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <vector>
+#include "LinkedList.h"
+#include "UnrolledLinkedList.h"
+#include "gmock\gmock.h"
+
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+
+/*
+Same tests as in TestLinkedList, the list is iterable so the gmock matchers
+can be used directly.
+*/
+
+TEST(TestUnrolledLinkedList, PushBack) {
+  // Preparations
+  UnrolledLinkedList list;
+
+  // Operation
+  list.push_back(1);
+  list.push_back(2);
+  list.push_back(3);
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(1, 2, 3));
+  EXPECT_EQ(list.size(), 3);
+}
+
+TEST(TestUnrolledLinkedList, PushFront) {
+  // Preparations
+  UnrolledLinkedList list;
+
+  // Operation
+  list.push_front(1);
+  list.push_front(2);
+
+  // Tests
+  ASSERT_THAT(list, ElementsAre(2, 1));
+}
+
+TEST(TestUnrolledLinkedList, PopBackPopFront) {
+  UnrolledLinkedList list{1, 2, 3, 4};
+
+  list.pop_back();
+  list.pop_front();
+  ASSERT_THAT(list, ElementsAre(2, 3));
+
+  list.pop_back();
+  list.pop_back();
+  ASSERT_THAT(list, ElementsAre());
+  EXPECT_TRUE(list.empty());
+}
+
+TEST(TestUnrolledLinkedList, Insert) {
+  UnrolledLinkedList list{1, 2};
+
+  // insert element into index 1
+  list.insert(1, 5);
+  ASSERT_THAT(list, ElementsAre(1, 5, 2));
+}
+
+TEST(TestUnrolledLinkedList, InsertIntoFullBlock) {
+  // Preparations
+  // Fill exactly one block, the insert has to split it.
+  std::vector<int> expected(UnrolledLinkedList::kBlockCapacity);
+  std::iota(expected.begin(), expected.end(), 0);
+  UnrolledLinkedList list;
+  for (int value : expected) list.push_back(value);
+  EXPECT_EQ(list.block_count(), 1);
+
+  // Operation
+  list.insert(10, -1);
+  expected.insert(expected.begin() + 10, -1);
+
+  // Tests
+  EXPECT_EQ(list.block_count(), 2);
+  ASSERT_THAT(list, ElementsAreArray(expected));
+  EXPECT_EQ(list.at(10), -1);
+  EXPECT_EQ(list.at(list.size() - 1), expected.back());
+}
+
+TEST(TestUnrolledLinkedList, Erase) {
+  UnrolledLinkedList list{10, 20, 30};
+
+  list.erase(1);  // by index
+  ASSERT_THAT(list, ElementsAre(10, 30));
+}
+
+TEST(TestUnrolledLinkedList, RemoveIf) {
+  // Preparations
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+  UnrolledLinkedList list;
+  for (int value : values) list.push_back(value);
+
+  // Operation
+  // Remove all the values of the first blocks and every odd one.
+  auto pred = [](int value) { return value < 200 || value % 2 == 1; };
+  list.remove_if(pred);
+  values.erase(std::remove_if(values.begin(), values.end(), pred),
+               values.end());
+
+  // Tests
+  ASSERT_THAT(list, ElementsAreArray(values));
+  EXPECT_EQ(list.size(), values.size());
+  // 400 values: the first block kept 28 and took in the next one, the other
+  // ten blocks are exactly half full and stay
+  EXPECT_EQ(list.block_count(), 11);
+}
+
+TEST(TestUnrolledLinkedList, RemoveIfMergesSparseBlocks) {
+  // Preparations
+  UnrolledLinkedList list;
+  for (int i = 0; i < 6400; i++) list.push_back(i);
+
+  // Operation, one value per block survives
+  list.remove_if([](int value) { return value % 64 != 0; });
+
+  // Tests
+  EXPECT_EQ(list.size(), 100);
+  EXPECT_EQ(list.block_count(), 2);
+  EXPECT_EQ(list.at(99), 6336);
+  list.push_back(-1);
+  EXPECT_EQ(list.at(100), -1);
+}
+
+TEST(TestUnrolledLinkedList, PopBackThroughBlocks) {
+  // Preparations, blocks made by push_back, push_front, a split and reverse
+  UnrolledLinkedList list;
+  std::vector<int> expected;
+  for (int i = 0; i < 150; i++) list.push_back(i);
+  for (int i = 0; i < 70; i++) list.push_front(-i);
+  list.insert(100, 1000);
+  list.reverse();
+  for (int value : list) expected.push_back(value);
+
+  // Operation and Tests, every block is emptied from the back
+  while (!expected.empty()) {
+    list.pop_back();
+    expected.pop_back();
+    ASSERT_EQ(list.size(), expected.size());
+  }
+  EXPECT_EQ(list.block_count(), 0);
+  EXPECT_EQ(list.begin(), list.end());
+  list.push_back(7);
+  list.push_front(6);
+  EXPECT_THAT(list, ElementsAre(6, 7));
+}
+
+TEST(TestUnrolledLinkedList, Remove) {
+  UnrolledLinkedList list{10, 20, 30};
+
+  list.remove(20);
+  ASSERT_THAT(list, ElementsAre(10, 30));
+}
+
+TEST(TestUnrolledLinkedList, Reverse) {
+  // Preparations
+  std::vector<int> values(200);
+  std::iota(values.begin(), values.end(), 0);
+  UnrolledLinkedList list;
+  for (int value : values) list.push_back(value);
+
+  // Operation
+  list.reverse();
+  std::reverse(values.begin(), values.end());
+
+  // Tests
+  ASSERT_THAT(list, ElementsAreArray(values));
+  list.push_back(-1);
+  EXPECT_EQ(list.at(200), -1);
+}
+
+/*
+Benchmark, run with --gtest_also_run_disabled_tests.
+Full scan and remove_if over the unrolled list, LinkedList and std::list.
+*/
+TEST(TestUnrolledLinkedList, DISABLED_BenchmarkScan) {
+  const int N = 5000000;
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+  };
+  auto is_odd = [](int value) { return value % 2 == 1; };
+
+  UnrolledLinkedList unrolled;
+  LinkedList linked;
+  std::list<int> std_list;
+  for (int i = 0; i < N; i++) {
+    unrolled.push_back(i);
+    linked.push_back(i);
+    std_list.push_back(i);
+  }
+
+  auto start = Clock::now();
+  long long sum = std::accumulate(unrolled.begin(), unrolled.end(), 0LL);
+  unrolled.remove_if(is_odd);
+  std::cout << "UnrolledLinkedList: " << ms(Clock::now() - start)
+            << " ms (sum " << sum << ")" << std::endl;
+
+  start = Clock::now();
+  sum = std::accumulate(linked.begin(), linked.end(), 0LL);
+  linked.remove_if(is_odd);
+  std::cout << "LinkedList: " << ms(Clock::now() - start) << " ms (sum "
+            << sum << ")" << std::endl;
+
+  start = Clock::now();
+  sum = std::accumulate(std_list.begin(), std_list.end(), 0LL);
+  std_list.remove_if(is_odd);
+  std::cout << "std::list: " << ms(Clock::now() - start) << " ms (sum "
+            << sum << ")" << std::endl;
+}